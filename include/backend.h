@@ -0,0 +1,40 @@
+#ifndef BACKEND_H_
+#define BACKEND_H_
+
+#include "lambda.h"
+
+#include <memory>
+#include <string>
+#include <map>
+
+namespace lambda {
+
+  // reduces a whole query to normal form in one go, in place of the tree
+  // rewriter of Reducer::reduce. `{}` and `$` have no effect on it
+  class Backend {
+  public:
+    virtual ~Backend() = default;
+
+    // the normal form of `expression`, which is left as it is. symbols of
+    // `symbol_table` are unfolded where needed, `step` is set to the number
+    // of rewrites
+    virtual auto normalize(
+      Expression* expression,
+      std::map<std::string, Expression*>& symbol_table,
+      unsigned long long& step
+    ) -> Expression* = 0;
+
+    // what the rewrites were, printed after the result
+    virtual auto get_statistics() -> std::string = 0;
+  };
+
+  // throws when there is no engine named `name`
+  auto engine_from_name(const std::string& name) -> EngineType;
+  auto engine_name(EngineType engine_type) -> std::string;
+
+  // nullptr for EngineType::Tree, which is Reducer::reduce itself
+  auto make_backend(EngineType engine_type) -> std::unique_ptr<Backend>;
+
+}
+
+#endif
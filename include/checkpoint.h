@@ -0,0 +1,64 @@
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include "lambda.h"
+
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace lambda {
+
+  // a query saved in the middle of its reduction, along with the symbols it
+  // may unfold, so that it can be continued by another process
+  struct Checkpoint {
+    // the query as written, printed as "to be sought"
+    Expression* query = nullptr;
+    // the term reached after `step` steps
+    Expression* expression = nullptr;
+    unsigned long long step = 0;
+    // time spent on the query so far
+    clock_t msec = 0;
+    std::vector<std::pair<std::string, Expression*>> symbols;
+
+    ~Checkpoint();
+  };
+
+  // throws unless `path` holds a checkpoint
+  void read_checkpoint(const std::string& path, Checkpoint& checkpoint);
+
+  // saves the query being reduced every `steps` steps, or every `seconds`
+  // seconds of wall clock when `steps` is 0. a checkpoint replaces the
+  // previous one with replace_file, so that a process killed while saving
+  // leaves the previous one intact
+  class CheckpointWriter {
+  public:
+    CheckpointWriter(
+      const std::string& path,
+      unsigned long long steps,
+      unsigned long long seconds
+    );
+
+    bool is_due(unsigned long long step);
+
+    // warns on stderr when the checkpoint cannot be written
+    void save(
+      Expression* query,
+      Expression* expression,
+      unsigned long long step,
+      clock_t msec,
+      std::map<std::string, Expression*>& symbol_table
+    );
+
+  private:
+    std::string path;
+    unsigned long long steps;
+    std::chrono::steady_clock::duration interval;
+    std::chrono::steady_clock::time_point last_save;
+  };
+
+}
+
+#endif
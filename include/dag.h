@@ -0,0 +1,29 @@
+#ifndef DAG_H_
+#define DAG_H_
+
+#include "lambda.h"
+
+#include <string>
+#include <vector>
+
+namespace lambda {
+
+  // a term with the closed subterms it repeats, up to alpha equivalence,
+  // printed once each as a definition
+  struct DagForm {
+    // `# _N := M` lines in an order they can be imported in, each one
+    // referring to the ones before it only. empty when nothing is repeated
+    std::vector<std::string> definitions;
+    // the term with every repeated subterm replaced by its name
+    std::string expression;
+  };
+
+  // subterms are told apart by a hash of their de Bruijn form and compared
+  // when hashes are equal. a subterm is counted once however many times the
+  // subterm it is in repeats, so that only the ones the printed definitions
+  // still repeat are hoisted
+  auto to_dag_form(Expression* expression) -> DagForm;
+
+}
+
+#endif
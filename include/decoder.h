@@ -0,0 +1,26 @@
+#ifndef DECODER_H_
+#define DECODER_H_
+
+#include "lambda.h"
+
+#include <optional>
+#include <string>
+
+namespace lambda {
+
+  // recognise `\f.\x. f (f ... x)`, the number of `f` is returned
+  auto decode_church_number(
+    Expression* expression
+  ) -> std::optional<unsigned long long>;
+
+  // recognise `T` and `F` of lib/logic.lambda
+  auto decode_boolean(Expression* expression) -> std::optional<bool>;
+
+  // numerals, booleans and `[]`/`*` lists of lib/pair.lambda are printed as
+  // `17`, `true` and `[2,3,5,7]`, anything else as `to_string()` does.
+  // `\a.\b. b` is both `0` and `F`, it is printed as `0`
+  auto to_decoded_string(Expression* expression) -> std::string;
+
+}
+
+#endif
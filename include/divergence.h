@@ -0,0 +1,53 @@
+#ifndef DIVERGENCE_H_
+#define DIVERGENCE_H_
+
+#include "lambda.h"
+
+#include <string>
+
+namespace lambda {
+
+  // watches the terms of a reduction, one after each step, for a term that
+  // comes back, which the reduction then repeats forever. found by Brent's
+  // algorithm on the cached hashes. a term is only copied once its hash
+  // comes back, and reported when the copy itself comes back as far apart,
+  // so that a reduction that ends costs no memory.
+  // terms that keep growing, e.g. `(\x. x x x) (\x. x x x)`, are not
+  // reported: whether they ever stop cannot be told in general, and telling
+  // them by a head redex that comes back stopped terminating recursions
+  class DivergenceDetector {
+  public:
+    ~DivergenceDetector();
+
+    // `expression` is the term after `step` steps. returns why the reduction
+    // diverges once that is found, an empty string until then
+    auto check(Expression* expression, unsigned long long step) -> std::string;
+
+  private:
+    // hash compared with the ones of every following term, replaced by the
+    // current one after `power` steps, `power` doubling each time
+    struct Checkpoint {
+      bool is_set = false;
+      size_t hash = 0;
+      unsigned long long size = 0;
+      unsigned long long step = 0;
+      unsigned long long power = 1;
+    };
+
+    // a term whose hash came back `distance` steps after it was seen, which
+    // a cycle brings back as many steps later
+    struct Candidate {
+      Expression* saved = nullptr;
+      unsigned long long step = 0;
+      unsigned long long distance = 0;
+    };
+
+    Checkpoint term;
+    Candidate candidate;
+
+    bool repeats(Expression* expression, unsigned long long step);
+  };
+
+}
+
+#endif
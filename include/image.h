@@ -0,0 +1,98 @@
+#ifndef IMAGE_H_
+#define IMAGE_H_
+
+#include "lambda.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+
+namespace lambda {
+
+  // binary encoding of expressions, shared by images and checkpoints
+  void write_expression(std::string& buffer, Expression* expression);
+  auto read_expression(const char*& cursor, const char* end) -> Expression*;
+
+  void write_string(std::string& buffer, const std::string& string);
+  auto read_string(const char*& cursor, const char* end) -> std::string;
+
+  void write_number(std::string& buffer, unsigned long long number);
+  auto read_number(const char*& cursor, const char* end) -> unsigned long long;
+
+  // write `buffer` to a temporary file next to `path`, sync it and rename it
+  // over `path`, so that readers find either the previous file or the new
+  // one whole, and a crash leaves one of them on disk. the temporary file is
+  // removed and false returned when any of it fails
+  bool replace_file(const std::string& path, const std::string& buffer);
+
+  // read-only memory mapping of a whole file
+  class MappedFile {
+  public:
+    MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile& other) = delete;
+    MappedFile& operator=(MappedFile& other) = delete;
+
+    bool is_open();
+    auto begin() -> const char*;
+    auto end() -> const char*;
+
+  private:
+    void* data;
+    size_t size;
+  };
+
+  // image of a source file: `nature.lambda` is compiled to `nature.lambdac`
+  auto image_path(const std::string& source_path) -> std::string;
+
+  // register the symbols of the image of `source_path`, and of the images of
+  // the files it imports, or only index them when `is_lazy`, see
+  // Reducer::defer_symbol. images hold definitions as they were parsed, each
+  // is passed to `define` to be registered, as a parsed one would be.
+  // return false and do nothing when any of the images is missing or older
+  // than its source
+  bool load_image(
+    const std::string& source_path,
+    Reducer& reducer,
+    bool is_lazy,
+    const std::function<void(const std::string&, Expression*&)>& define
+  );
+
+  // records what the imported source files define while they are parsed,
+  // images are written once parsing has finished
+  class ImageBuilder {
+  public:
+    void begin(const std::string& source_path);
+
+    // ignored unless `begin` was called on `source_path`, thus the input file
+    // itself never gets an image
+    void add_import(
+      const std::string& source_path,
+      const std::string& imported_path
+    );
+    void add_symbol(
+      const std::string& source_path,
+      const std::string& literal,
+      Expression* expression
+    );
+
+    void save();
+
+    ~ImageBuilder();
+
+  private:
+    struct Image {
+      std::vector<std::string> imports;
+      std::vector<std::pair<std::string, Expression*>> symbols;
+    };
+
+    std::map<std::string, Image> images;
+
+    void clear(Image& image);
+  };
+
+}
+
+#endif
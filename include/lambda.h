@@ -5,6 +5,10 @@
 #include <string>
 #include <map>
 #include <set>
+#include <vector>
+#include <memory>
+#include <ctime>
+#include <functional>
 
 namespace lambda {
 
@@ -12,7 +16,9 @@ namespace lambda {
   enum class ComputationalPriority {
     Lazy = -1,
     Neutral = 0,
-    Eager = 1
+    Eager = 1,
+    // eager until in head normal form only, see StrictnessAnalyzer
+    HeadEager = 2
   };
 
   enum class ReduceType {
@@ -22,6 +28,22 @@ namespace lambda {
     Delta = 3
   };
 
+  // order of reducing a query, see strategy.h
+  enum class StrategyType {
+    Annotated = 0,
+    NormalOrder,
+    ApplicativeOrder,
+    CallByValue,
+    HeadNormalForm
+  };
+
+  // what reduces a query, see backend.h
+  enum class EngineType {
+    Tree = 0,
+    Net,
+    Ski
+  };
+
   // priority syntactically, used for printing
   enum class Priority {
     Abstraction = 0,
@@ -30,18 +52,25 @@ namespace lambda {
   };
 
   class Variable;
+  struct ExplicitSubstitution;
   class Expression {
   public:
     Expression(ComputationalPriority computational_priority);
+    Expression(const Expression& other);
+
+    // expressions allocated and not yet deleted, see progress.h
+    static auto get_live_count() -> unsigned long long;
 
     // delete this recursively
     // crash when this is not allocated dynamically
     virtual void delete_instance() = 0;
 
-    // beta and delta reduce
+    // beta and delta reduce. `substitution` is nullptr but in the explicit
+    // substitution mode, see Closure
     virtual auto reduce(
       std::map<std::string, Expression*>& symbol_table,
-      std::multiset<std::string>& bound_variables
+      std::multiset<std::string>& bound_variables,
+      ExplicitSubstitution* substitution
     ) -> std::pair<Expression*, ReduceType> = 0;
 
     virtual auto replace(
@@ -74,11 +103,27 @@ namespace lambda {
       std::multiset<std::string>& bound_variables
     ) = 0;
 
+    // structural hash and number of nodes, cached until the subtree changes.
+    // binders are hashed by name, computational priorities are left out
+    auto get_hash() -> size_t;
+    auto get_size() -> unsigned long long;
+    virtual void update_hash() = 0;
+    // to be called on every node above a child replaced through a reference
+    // from e.g. `get_first()`, the reductions of the nodes themselves keep
+    // their caches up to date
+    void invalidate_hash();
+
     bool is_lazy();
 
+    // whether `reduce` has found this in normal form
+    bool is_in_normal_form();
+    // found in normal form by a strategy that searches the redex itself
+    void set_normal_form();
+
     void set_computational_priority(
       ComputationalPriority computational_priority
     );
+    auto get_computational_priority() -> ComputationalPriority;
 
   protected:
     ComputationalPriority computational_priority_flag;
@@ -88,7 +133,19 @@ namespace lambda {
 
     bool is_normal_form;
 
-    virtual ~Expression() = default;
+    bool is_hash_updated;
+    size_t hash_value;
+    unsigned long long size_value;
+
+    static unsigned long long live_count;
+
+    // cached hash and size of `other`, which is structurally equal to this
+    void copy_hash(Expression& other);
+
+    virtual ~Expression();
+
+    // pushes substitutions into the nodes below it
+    friend class Closure;
   };
 
   // root of AST, behavior trying to reduce a tree without Root is unexpected
@@ -106,7 +163,8 @@ namespace lambda {
 
     auto reduce(
       std::map<std::string, Expression*>& symbol_table,
-      std::multiset<std::string>& bound_variables
+      std::multiset<std::string>& bound_variables,
+      ExplicitSubstitution* substitution
     ) -> std::pair<Expression*, ReduceType> override;
 
     auto replace(
@@ -135,6 +193,12 @@ namespace lambda {
       std::multiset<std::string>& bound_variables
     ) override;
 
+    void update_hash() override;
+
+    // the child may be replaced through the reference, the cached hash is
+    // invalidated, as by the other accessors of children
+    auto get_expression() -> Expression*&;
+
   private:
     Expression* expression;
   };
@@ -161,7 +225,8 @@ namespace lambda {
 
     auto reduce(
       std::map<std::string, Expression*>& symbol_table,
-      std::multiset<std::string>& bound_variables
+      std::multiset<std::string>& bound_variables,
+      ExplicitSubstitution* substitution
     ) -> std::pair<Expression*, ReduceType> override;
 
     auto replace(
@@ -190,6 +255,8 @@ namespace lambda {
       std::multiset<std::string>& bound_variables
     ) override;
 
+    void update_hash() override;
+
   private:
     std::string literal;
   };
@@ -214,7 +281,8 @@ namespace lambda {
 
     auto reduce(
       std::map<std::string, Expression*>& symbol_table,
-      std::multiset<std::string>& bound_variables
+      std::multiset<std::string>& bound_variables,
+      ExplicitSubstitution* substitution
     ) -> std::pair<Expression*, ReduceType> override;
 
     auto replace(
@@ -243,6 +311,18 @@ namespace lambda {
       std::multiset<std::string>& bound_variables
     ) override;
 
+    void update_hash() override;
+
+    auto get_binder() -> Variable&;
+    auto get_body() -> Expression*&;
+
+    // `apply` of the explicit substitution mode: the substitution is left to
+    // a closure, which takes over `expression`. deletes this
+    auto apply_later(
+      Expression* expression,
+      ExplicitSubstitution& substitution
+    ) -> Expression*;
+
   private:
     Variable binder;
     Expression* body;
@@ -267,7 +347,8 @@ namespace lambda {
 
     auto reduce(
       std::map<std::string, Expression*>& symbol_table,
-      std::multiset<std::string>& bound_variables
+      std::multiset<std::string>& bound_variables,
+      ExplicitSubstitution* substitution
     ) -> std::pair<Expression*, ReduceType> override;
 
     auto replace(
@@ -296,6 +377,18 @@ namespace lambda {
       std::multiset<std::string>& bound_variables
     ) override;
 
+    void update_hash() override;
+
+    auto get_first() -> Expression*&;
+    auto get_second() -> Expression*&;
+
+    // beta reduce this if `first` can be applied to `second`, into a
+    // closure when `substitution` is given
+    auto contract(
+      std::multiset<std::string>& bound_variables,
+      ExplicitSubstitution* substitution = nullptr
+    ) -> std::pair<Expression*, ReduceType>;
+
   private:
     Expression* first;
     Expression* second;
@@ -304,29 +397,407 @@ namespace lambda {
 
     auto reduce_first(
       std::map<std::string, Expression*>& symbol_table,
-      std::multiset<std::string>& bound_variables
+      std::multiset<std::string>& bound_variables,
+      ExplicitSubstitution* substitution
     ) -> std::pair<bool, ReduceType>;
 
     auto reduce_second(
       std::map<std::string, Expression*>& symbol_table,
-      std::multiset<std::string>& bound_variables
+      std::multiset<std::string>& bound_variables,
+      ExplicitSubstitution* substitution
     ) -> std::pair<bool, ReduceType>;
   };
 
+  // a numeric literal after its delta reduction. behaves and prints as the
+  // Church numeral `\f.\x. f (... (f x))`, which is only built when the
+  // numeral is applied
+  class Numeral: public Expression {
+  public:
+    Numeral(
+      unsigned value,
+      ComputationalPriority computational_priority = ComputationalPriority::Neutral
+    );
+    void delete_instance() override;
+
+    Numeral(Numeral& other) = default;
+    Numeral(Numeral&& other) = default;
+    Numeral& operator=(Numeral& other) = default;
+    Numeral& operator=(Numeral&& other) = default;
+
+    auto reduce(
+      std::map<std::string, Expression*>& symbol_table,
+      std::multiset<std::string>& bound_variables,
+      ExplicitSubstitution* substitution
+    ) -> std::pair<Expression*, ReduceType> override;
+
+    auto replace(
+      Variable& variable,
+      Expression& expression,
+      std::multiset<std::string>& bound_variables
+    ) -> std::pair<Expression*, ReduceType> override;
+
+    auto apply(
+      Expression& expression,
+      std::multiset<std::string>& bound_variables
+    ) -> std::pair<Expression*, ReduceType> override;
+
+    auto to_string() -> std::string override;
+
+    auto get_priority() -> Priority override;
+
+    auto clone() -> Expression* override;
+    auto clone(
+      ComputationalPriority new_computational_priority
+    ) -> Expression* override;
+
+    bool is_variable_free(const std::string& literal) override;
+
+    void update_eager_flag(
+      std::multiset<std::string>& bound_variables
+    ) override;
+
+    void update_hash() override;
+
+    auto get_value() -> unsigned;
+
+    // the Church numeral this stands for
+    auto expand() -> Expression*;
+
+  private:
+    unsigned value;
+
+    ~Numeral() = default;
+  };
+
+  struct NativeOperator;
+
+  // a symbol of lib/nature.lambda with a native delta rule, see native.h.
+  // collects its arguments, computes the result when all of them are
+  // numerals and unfolds to the definition applied to them otherwise
+  class Primitive: public Expression {
+  public:
+    Primitive(
+      const NativeOperator* native_operator,
+      std::shared_ptr<Expression> definition,
+      ComputationalPriority computational_priority = ComputationalPriority::Neutral
+    );
+    void delete_instance() override;
+
+    Primitive(Primitive& other) = default;
+    Primitive(Primitive&& other) = default;
+    Primitive& operator=(Primitive& other) = default;
+    Primitive& operator=(Primitive&& other) = default;
+
+    auto reduce(
+      std::map<std::string, Expression*>& symbol_table,
+      std::multiset<std::string>& bound_variables,
+      ExplicitSubstitution* substitution
+    ) -> std::pair<Expression*, ReduceType> override;
+
+    auto replace(
+      Variable& variable,
+      Expression& expression,
+      std::multiset<std::string>& bound_variables
+    ) -> std::pair<Expression*, ReduceType> override;
+
+    auto apply(
+      Expression& expression,
+      std::multiset<std::string>& bound_variables
+    ) -> std::pair<Expression*, ReduceType> override;
+
+    auto to_string() -> std::string override;
+
+    auto get_priority() -> Priority override;
+
+    auto clone() -> Expression* override;
+    auto clone(
+      ComputationalPriority new_computational_priority
+    ) -> Expression* override;
+
+    bool is_variable_free(const std::string& literal) override;
+
+    void update_eager_flag(
+      std::multiset<std::string>& bound_variables
+    ) override;
+
+    void update_hash() override;
+
+    // the definition applied to the collected arguments
+    auto expand() -> Expression*;
+
+    auto get_native_operator() -> const NativeOperator*;
+
+    // arguments it takes before it is computed
+    auto get_missing_count() -> size_t;
+    // takes `argument` as it is, as `P M N` does with `M` when it is
+    // contracted at once
+    void collect(Expression* argument);
+
+  private:
+    const NativeOperator* native_operator;
+    // shared by all unfoldings of the symbol, never reduced
+    std::shared_ptr<Expression> definition;
+    std::vector<Expression*> arguments;
+
+    ~Primitive() = default;
+
+    // the definition applied to the arguments, deletes this
+    auto unfold() -> Expression*;
+    // the definition with the arguments substituted for its parameters, as
+    // the steps that collected them stand for, deletes this
+    auto instantiate(std::multiset<std::string>& bound_variables) -> Expression*;
+
+    // the value of a numeral argument, false if it is none
+    bool get_numeral(
+      Expression* argument,
+      std::multiset<std::string>& bound_variables,
+      unsigned& value
+    );
+  };
+
+  // what the reduction of a query in the explicit substitution mode keeps
+  // track of, owned by the Reducer
+  struct ExplicitSubstitution {
+    // single steps closures are pushed down by
+    unsigned long long substitution_count = 0;
+    // closures alive, none are looked for once all are pushed out
+    unsigned long long closure_count = 0;
+  };
+
+  // `body` with `binder` substituted by `argument`, made by beta reductions
+  // of the explicit substitution mode instead of substituting at once. the
+  // substitution is pushed one node down whenever the node is looked at, so
+  // that it never reaches the parts of the body that are discarded
+  class Closure: public Expression {
+  public:
+    // takes over `argument`, counted in `substitution`
+    Closure(
+      Expression* body,
+      Variable binder,
+      Expression* argument,
+      ExplicitSubstitution& substitution,
+      ComputationalPriority computational_priority = ComputationalPriority::Neutral
+    );
+    void delete_instance() override;
+
+    Closure(Closure& other) = default;
+    Closure(Closure&& other) = default;
+    Closure& operator=(Closure& other) = default;
+    Closure& operator=(Closure&& other) = default;
+
+    auto reduce(
+      std::map<std::string, Expression*>& symbol_table,
+      std::multiset<std::string>& bound_variables,
+      ExplicitSubstitution* substitution
+    ) -> std::pair<Expression*, ReduceType> override;
+
+    auto replace(
+      Variable& variable,
+      Expression& expression,
+      std::multiset<std::string>& bound_variables
+    ) -> std::pair<Expression*, ReduceType> override;
+
+    auto apply(
+      Expression& expression,
+      std::multiset<std::string>& bound_variables
+    ) -> std::pair<Expression*, ReduceType> override;
+
+    // the term with the substitutions carried out, printed without building
+    // it
+    auto to_string() -> std::string override;
+
+    auto get_priority() -> Priority override;
+
+    auto clone() -> Expression* override;
+    auto clone(
+      ComputationalPriority new_computational_priority
+    ) -> Expression* override;
+
+    bool is_variable_free(const std::string& literal) override;
+
+    // as the term with the substitutions carried out, which is not built
+    void update_eager_flag(
+      std::multiset<std::string>& bound_variables
+    ) override;
+
+    // of the closure as it is, the body, binder and argument
+    void update_hash() override;
+
+    // the body with the substitution moved onto its children, deletes this.
+    // `bound_variables` are the ones bound where this is
+    auto push(std::multiset<std::string>& bound_variables) -> Expression*;
+
+    // binders and closures around a closure, see lambda.cpp
+    struct Scope;
+
+    // whether `literal` is free once the substitutions of this and of the
+    // closures in `scope` are carried out, the binders of `scope` but the
+    // `inner_count` innermost ones leaving their variables free
+    bool is_variable_free_in(
+      const std::string& literal,
+      const Scope* scope,
+      size_t inner_count
+    );
+
+    // as `to_string()`, under the substitutions of `scope`, with its priority
+    auto to_string_in(const Scope* scope) -> std::pair<std::string, Priority>;
+
+    // as `is_eager()` under the substitutions of `scope`, given `priority`
+    bool is_eager_in(
+      ComputationalPriority priority,
+      std::multiset<std::string>& bound_variables,
+      const Scope* scope
+    );
+
+    // a copy with every substitution carried out
+    auto substitute() -> Expression*;
+
+  private:
+    // shared by the closures the substitution is pushed into, never reduced
+    struct Argument {
+      Expression* expression;
+      ExplicitSubstitution& substitution;
+      // whether the closures in `expression` are pushed out, which is done
+      // before it is first copied
+      bool is_pushed;
+      // whether a literal is free in `expression`, asked once per binder the
+      // substitution is pushed under
+      std::map<std::string, bool> free_literals;
+
+      ~Argument();
+      bool is_variable_free(const std::string& literal);
+    };
+
+    Expression* body;
+    Variable binder;
+    std::shared_ptr<Argument> argument;
+
+    Closure(
+      Expression* body,
+      Variable binder,
+      std::shared_ptr<Argument> argument,
+      ComputationalPriority computational_priority
+    );
+    ~Closure();
+  };
+
   auto generate_church_number(unsigned number) -> Expression*;
 
+  // options of reducing, set from command line
+  struct ReduceOptions {
+    bool display_process = false;
+    // print numerals, booleans and lists in decoded form
+    bool decode_result = false;
+    // print the subterms the result repeats once each, as definitions, see
+    // dag.h
+    bool print_dag = false;
+    // load imported files from their images, see image.h
+    bool use_image = false;
+    // steps each definition may be reduced ahead of time, 0 to disable
+    unsigned long long prenormalize_budget = 0;
+    StrategyType strategy = StrategyType::Annotated;
+    EngineType engine = EngineType::Tree;
+    // print the result while it is reduced, see stream.h
+    bool stream_result = false;
+    // stop on repeating or steadily growing terms, see divergence.h
+    bool detect_divergence = false;
+    // mark strict arguments eager, see strictness.h
+    bool analyze_strictness = false;
+    // contract redexes that cannot duplicate work ahead of time, see
+    // optimizer.h
+    bool optimize = false;
+    // defer substitutions of the annotated strategy, see Closure
+    bool explicit_substitution = false;
+    // save the query being reduced to `checkpoint_path` every
+    // `checkpoint_steps` steps, or every `checkpoint_seconds` seconds when
+    // that is 0, see checkpoint.h. disabled when the path is empty
+    std::string checkpoint_path;
+    unsigned long long checkpoint_steps = 0;
+    unsigned long long checkpoint_seconds = 60;
+    // continue the query of this checkpoint instead of reading input
+    std::string resume_path;
+    // register imported definitions once a query refers to them, see
+    // Reducer::defer_symbol
+    bool lazy_imports = false;
+    // print a progress line to stderr every `progress_seconds` seconds while
+    // a query is reduced, 0 to disable, see progress.h
+    unsigned long long progress_seconds = 0;
+  };
+
   class Reducer {
   public:
     auto reduce(
-      Expression* expression, FILE* out_stream, bool display_process
+      Expression* expression, FILE* out_stream, const ReduceOptions& options
+    ) -> Expression*;
+
+    // continue the query saved in checkpoint `path`, whose symbols are
+    // registered first
+    auto resume(
+      const std::string& path, FILE* out_stream, const ReduceOptions& options
     ) -> Expression*;
 
     void register_symbol(std::string literal, Expression* expression);
 
+    // leave `literal` out of the symbol table until `materialize` finds a
+    // reference to it. the definition is `expression`, or what `load`
+    // returns when that is nullptr, and is passed to `define`, or registered
+    // as is when `define` is empty
+    void defer_symbol(
+      const std::string& literal,
+      Expression* expression,
+      std::function<Expression*()> load,
+      std::function<void(Expression*)> define
+    );
+
+    // define the deferred symbols free in `expression`, and the ones free in
+    // their definitions in turn. those are defined first, so that e.g.
+    // prenormalization finds them registered
+    void materialize(Expression* expression);
+
+    // the definition of `literal`, nullptr when there is none
+    auto find_symbol(const std::string& literal) -> Expression*;
+
+    // register the symbols of lib/nature.lambda with native delta rules from
+    // now on, only for the annotated strategy
+    void use_native_arithmetic();
+
+    // reduce the body of definition `literal` before it is registered, within
+    // `budget` steps. returns the steps taken, which every unfolding saves
+    auto prenormalize(
+      const std::string& literal,
+      Expression*& expression,
+      unsigned long long budget
+    ) -> unsigned long long;
+
     ~Reducer();
 
   private:
     std::map<std::string, Expression*> symbol_table;
+    bool native_arithmetic = false;
+    // outlives the closures of every query
+    ExplicitSubstitution substitution;
+
+    struct DeferredSymbol {
+      Expression* expression;
+      std::function<Expression*()> load;
+      std::function<void(Expression*)> define;
+    };
+    std::map<std::string, DeferredSymbol> deferred_symbols;
+
+    // reduce `expression`, which `query` became after `first_step` steps
+    // taking `msec`
+    auto reduce_from(
+      Expression* query,
+      Expression* expression,
+      unsigned long long first_step,
+      clock_t msec,
+      FILE* out_stream,
+      const ReduceOptions& options
+    ) -> Expression*;
+
+    // unfold the native operators that refer to a symbol redefined since
+    // they were registered
+    void check_native_operators();
   };
 
 }
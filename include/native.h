@@ -0,0 +1,38 @@
+#ifndef NATIVE_H_
+#define NATIVE_H_
+
+#include "lambda.h"
+
+#include <string>
+#include <vector>
+#include <map>
+
+namespace lambda {
+
+  // a symbol of lib/nature.lambda whose result is computed natively once it
+  // is applied to `arity` numerals
+  struct NativeOperator {
+    const char* literal;
+    // the library definition as `to_string` prints it, which a definition
+    // has to be alpha equivalent to
+    const char* definition;
+    unsigned arity;
+    // nullptr when the definition has to be unfolded instead, e.g. `%n m 0`
+    // which never reaches a normal form
+    Expression* (*evaluate)(const std::vector<unsigned>& arguments);
+  };
+
+  // the operator of symbol `literal`, nullptr unless `definition` is the one
+  // of lib/nature.lambda, up to the names of its bound variables, and every
+  // symbol it refers to is defined in `symbol_table` as the library defines
+  // it, so that a file redefining e.g. `T` keeps its own rules. `^n` is not
+  // among them, its results are eta expanded numerals with other binders
+  auto find_native_operator(
+    const std::string& literal,
+    Expression* definition,
+    const std::map<std::string, Expression*>& symbol_table
+  ) -> const NativeOperator*;
+
+}
+
+#endif
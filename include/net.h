@@ -0,0 +1,165 @@
+#ifndef NET_H_
+#define NET_H_
+
+#include "backend.h"
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <memory>
+
+namespace lambda {
+
+  // Lamping's algorithm: the query is translated into a sharing graph of
+  // lambdas, applications, fans, brackets and croissants, the graph is
+  // reduced with optimal sharing and read back. work shared by the copies of
+  // a term is done once, so that `^n 10 4` or a numeral applied to a numeral
+  // take far fewer steps than on the tree.
+  //
+  // every agent has a level, the number of arguments it is nested in. an
+  // argument is a box one level deeper than its application, whose free
+  // variables leave it through brackets, and every variable is reached
+  // through a croissant. brackets and croissants raise and lower the levels
+  // of the agents they cross, so that two fans of one level meet only when
+  // they are the two halves of one copy, for any term
+  //
+  // symbols are agents of their own that are unfolded when applied and
+  // copied by fans, so that recursive definitions are unfolded on demand.
+  // the graph is reduced as far as reading back the result requires, pairs
+  // in discarded parts of it are never reduced
+  class NetBackend: public Backend {
+  public:
+    auto normalize(
+      Expression* expression,
+      std::map<std::string, Expression*>& symbol_table,
+      unsigned long long& step
+    ) -> Expression* override;
+
+    auto get_statistics() -> std::string override;
+
+  private:
+    using Port = uint32_t;
+
+    // the terms first, then the agents that move through them
+    enum class Kind: uint8_t {
+      Root = 0,
+      Lambda,
+      Application,
+      Reference,
+      Free,
+      Fan,
+      Croissant,
+      Bracket,
+      Eraser
+    };
+
+    // ports 0, 1 and 2 of a node are its principal port and its auxiliary
+    // ports. a lambda has its variable at 1 and its body at 2, an
+    // application its argument at 1 and its result at 2. brackets and
+    // croissants have port 1 only, pointing away from the binder
+    struct Node {
+      Port ports[3];
+      Kind kind;
+      // the binder of a lambda, the symbol of a reference or the name of a
+      // free variable, an index into `names`
+      uint32_t label;
+      int32_t level;
+    };
+
+    // what a path through the graph has crossed, one stack per level: the
+    // ports fans were entered by, the croissants crossed, and the two levels
+    // a bracket merged into one. nullptr is the empty level
+    struct Level;
+    using LevelPtr = std::shared_ptr<const Level>;
+    struct Level {
+      enum class Tag: uint8_t { Choice, Mark, Pair } tag;
+      uint32_t slot;
+      // the rest of the stack below a choice, or the first level of a pair
+      LevelPtr first;
+      LevelPtr second;
+    };
+    using Context = std::vector<LevelPtr>;
+
+    // a lambda being read back, and the context it was reached in
+    struct Binder {
+      uint32_t node;
+      Context context;
+      std::string literal;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> free_nodes;
+    std::vector<std::string> names;
+    std::map<std::string, uint32_t> name_indices;
+    std::set<std::string> free_literals;
+
+    std::map<std::string, Expression*>* symbol_table = nullptr;
+
+    unsigned long long beta_count = 0;
+    unsigned long long fan_count = 0;
+    unsigned long long bracket_count = 0;
+    unsigned long long unfold_count = 0;
+    unsigned long long erase_count = 0;
+
+    static auto port(uint32_t node, uint32_t slot) -> Port;
+    static auto node_of(Port port) -> uint32_t;
+    static auto slot_of(Port port) -> uint32_t;
+
+    auto enter(Port port) -> Port;
+    void link(Port a, Port b);
+    auto make_node(Kind kind, uint32_t label, int32_t level) -> uint32_t;
+    void free_node(uint32_t node);
+    auto name_index(const std::string& name) -> uint32_t;
+
+    static bool is_agent(Kind kind);
+    static auto arity(Kind kind) -> uint32_t;
+
+    // the port a term at `level` is reached by. `free_ports`, empty at
+    // first, is given the port each variable bound outside it is to be
+    // linked to, one for all of its occurrences
+    auto encode(
+      Expression* expression,
+      int32_t level,
+      std::multiset<std::string>& bound_variables,
+      std::map<std::string, Port>& free_ports
+    ) -> Port;
+    auto encode_numeral(unsigned value, int32_t level) -> Port;
+
+    bool is_active(uint32_t a, uint32_t b);
+    void rewrite(uint32_t a, uint32_t b);
+    void annihilate(uint32_t a, uint32_t b);
+    // `node` passes through `agent` and is copied for each of its auxiliary
+    // ports, `agent` is copied for each of the auxiliary ports of `node`
+    void commute(uint32_t agent, uint32_t node);
+    void unfold(uint32_t reference);
+
+    // reduce the pair on `principal`, or the pairs that one waits for.
+    // returns whether the node of `principal` was rewritten
+    bool reduce_at(Port principal);
+
+    static auto level_at(const Context& context, int32_t index) -> LevelPtr;
+    static bool is_same_level(const LevelPtr& a, const LevelPtr& b);
+
+    // the auxiliary port a path leaves a fan, a croissant or a bracket by
+    // when it enters it by its principal port, and the other way round
+    auto leave_agent(uint32_t node, Context& context) -> uint32_t;
+    void enter_agent(uint32_t node, uint32_t slot, Context& context);
+    auto find_binder(
+      uint32_t node,
+      const Context& context,
+      const std::vector<Binder>& binders
+    ) -> std::string;
+
+    auto read_back(
+      Port port,
+      Context context,
+      std::vector<Binder>& binders,
+      std::multiset<std::string>& bound_variables
+    ) -> Expression*;
+  };
+
+}
+
+#endif
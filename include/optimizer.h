@@ -0,0 +1,50 @@
+#ifndef OPTIMIZER_H_
+#define OPTIMIZER_H_
+
+#include "lambda.h"
+
+#include <string>
+#include <set>
+
+namespace lambda {
+
+  // rewrites a query or definition before it is reduced, without changing
+  // its normal form. contracts the redexes whose argument is a variable or
+  // is used at most once, which drops the arguments that are not used, and
+  // eta reduces `\x. M x` where M is known to reduce to an abstraction, so
+  // that the result is alpha equivalent. eager arguments are left alone,
+  // they are reduced once before they are substituted
+  class Optimizer {
+  public:
+    Optimizer(Reducer& reducer);
+
+    // optimize `expression`, the definition of `literal` or a query when
+    // `literal` is empty. returns what was done, empty when nothing was
+    auto optimize(
+      const std::string& literal,
+      Expression*& expression
+    ) -> std::string;
+
+  private:
+    using BoundVariables = std::multiset<std::string>;
+
+    Reducer& reducer;
+    // symbols whose arity is being computed, taken as 0
+    std::set<std::string> visiting;
+
+    unsigned long long contracted_count = 0;
+    unsigned long long dropped_count = 0;
+    unsigned long long eta_count = 0;
+
+    void rewrite(Expression*& expression, BoundVariables& bound_variables);
+
+    bool contract(Expression*& expression, BoundVariables& bound_variables);
+    bool eta_reduce(Expression*& expression, BoundVariables& bound_variables);
+
+    // abstractions `expression` starts with once unfolded, 0 when unknown
+    auto arity(Expression* expression, BoundVariables& bound_variables) -> unsigned;
+  };
+
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef PROGRESS_H_
+#define PROGRESS_H_
+
+#include "lambda.h"
+
+#include <chrono>
+#include <string>
+
+namespace lambda {
+
+  // print a snapshot of the reduction running when SIGUSR1 is received,
+  // from now on
+  void handle_progress_signal();
+
+  // reports to stderr how far the reduction of a query has got: every
+  // `seconds` seconds of wall clock, 0 for never, and when SIGUSR1 is
+  // received. the clock and the signal are looked at once every few steps,
+  // so that the reduction does not wait on them
+  class ProgressReporter {
+  public:
+    // the reduction starts from step `first_step`
+    ProgressReporter(unsigned long long seconds, unsigned long long first_step);
+
+    bool is_due(unsigned long long step);
+
+    // `expression` is the term after `step` steps
+    void report(Expression* expression, unsigned long long step);
+
+  private:
+    std::chrono::steady_clock::duration interval;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point last_report;
+    unsigned long long last_step;
+  };
+
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef SKI_H_
+#define SKI_H_
+
+#include "backend.h"
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+
+namespace lambda {
+
+  // Turner's combinator machine: the query is compiled by bracket
+  // abstraction into S, K, I, B, C and the optimized S', B*, C', with Y for
+  // symbols defined in terms of themselves. the graph is reduced in normal
+  // order and updated in place, so that every redex is reduced once however
+  // many times it is shared. there are no variables left, hence no capture
+  // check nor alpha renaming
+  //
+  // a function in weak head normal form is read back by applying it to a
+  // fresh free variable, so that the result is the normal form, with binders
+  // named anew. symbols are compiled once, when first unfolded, and the
+  // reductions inside them are shared by all their uses
+  class SkiBackend: public Backend {
+  public:
+    auto normalize(
+      Expression* expression,
+      std::map<std::string, Expression*>& symbol_table,
+      unsigned long long& step
+    ) -> Expression* override;
+
+    auto get_statistics() -> std::string override;
+
+  private:
+    enum class Kind: uint8_t {
+      Application = 0,
+      Combinator,
+      // replaced by its compiled definition when unfolded
+      Symbol,
+      Free,
+      // a bound variable, only while its abstraction is compiled
+      Variable,
+      // a reduced redex whose result is another cell
+      Indirection
+    };
+
+    enum class Combinator: uint8_t {
+      I = 0, K, S, B, C, SPrime, BStar, CPrime, Y
+    };
+
+    struct Cell {
+      Kind kind;
+      Combinator combinator;
+      // the function and the argument of an application, the target of an
+      // indirection, the name of a symbol or variable, an index into `names`
+      uint32_t first;
+      uint32_t second;
+    };
+
+    std::vector<Cell> cells;
+    std::vector<std::string> names;
+    std::map<std::string, uint32_t> name_indices;
+    std::set<std::string> free_literals;
+    // cell of each combinator, shared
+    std::vector<uint32_t> combinators;
+    // compiled definition of each symbol, by name
+    std::map<uint32_t, uint32_t> definitions;
+
+    std::map<std::string, Expression*>* symbol_table = nullptr;
+
+    unsigned long long combinator_count = 0;
+    unsigned long long unfold_count = 0;
+
+    auto make_cell(Kind kind, uint32_t first, uint32_t second) -> uint32_t;
+    auto make_application(uint32_t first, uint32_t second) -> uint32_t;
+    auto make_combinator(Combinator combinator) -> uint32_t;
+    auto name_index(const std::string& name) -> uint32_t;
+    auto follow(uint32_t cell) -> uint32_t;
+
+    auto compile(
+      Expression* expression,
+      std::multiset<std::string>& bound_variables
+    ) -> uint32_t;
+    auto compile_numeral(unsigned value) -> uint32_t;
+    auto compile_symbol(uint32_t name) -> uint32_t;
+    bool contains(uint32_t cell, uint32_t name);
+    // [name] cell
+    auto abstract(uint32_t name, uint32_t cell) -> uint32_t;
+    // whether `cell` is `B p q`
+    bool is_composition(uint32_t cell, uint32_t& p, uint32_t& q);
+
+    // reduce `cell` to weak head normal form. `spine` is left with the
+    // applications from `cell` down to the head, outermost first
+    void reduce(uint32_t cell, std::vector<uint32_t>& spine);
+    void rewrite(uint32_t redex, Combinator combinator, const uint32_t* arguments);
+
+    auto read_back(
+      uint32_t cell,
+      std::multiset<std::string>& bound_variables
+    ) -> Expression*;
+  };
+
+}
+
+#endif
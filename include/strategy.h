@@ -0,0 +1,38 @@
+#ifndef STRATEGY_H_
+#define STRATEGY_H_
+
+#include "lambda.h"
+
+#include <memory>
+#include <string>
+#include <map>
+
+namespace lambda {
+
+  // the order in which a query is reduced. every strategy counts one step per
+  // beta or delta reduction, so that step counts are comparable
+  class Strategy {
+  public:
+    virtual ~Strategy() = default;
+
+    // reduce `expression` one step in place, ReduceType::Null when done
+    virtual auto step(
+      Expression*& expression,
+      std::map<std::string, Expression*>& symbol_table
+    ) -> ReduceType = 0;
+  };
+
+  // throws when there is no strategy named `name`
+  auto strategy_from_name(const std::string& name) -> StrategyType;
+  auto strategy_name(StrategyType strategy_type) -> std::string;
+
+  // the annotated strategy defers substitutions to closures counted in
+  // `substitution` when it is given, see Closure
+  auto make_strategy(
+    StrategyType strategy_type,
+    ExplicitSubstitution* substitution = nullptr
+  ) -> std::unique_ptr<Strategy>;
+
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include "lambda.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace lambda {
+
+  // prints a term while it is being reduced, as far as it is final: subterms
+  // flagged in normal form, abstractions and applications whose head is a
+  // variable in normal form at positions that are final themselves. relies
+  // on the flags set by Expression::reduce, i.e. the annotated strategy.
+  // printing resumes where it stopped, so that every part is rendered once
+  class StreamPrinter {
+  public:
+    StreamPrinter(FILE* out);
+
+    // print what has become final since the last call
+    void update(Expression* expression);
+
+    // print the rest of `expression`, which must be in normal form
+    void finish(Expression* expression);
+
+  private:
+    // an abstraction or application partly printed. final ones are never
+    // replaced by the reduction, while their children may be until they are
+    // final, so children are looked up again on every call
+    struct Frame {
+      // nullptr for the term itself, whose root is replaced on every step
+      Expression* expression;
+      unsigned stage;
+      // whether the child being printed is parenthesized
+      bool is_parenthesized;
+    };
+
+    FILE* out;
+    std::vector<Frame> frames;
+    bool is_started;
+    // everything left is final, whatever its flags say
+    bool is_finishing;
+
+    // print on until something is not final yet
+    void resume(Expression* root);
+
+    // print a child that is final, or push it, false if it is not final
+    bool enter(Expression* child);
+  };
+
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef STRICTNESS_H_
+#define STRICTNESS_H_
+
+#include "lambda.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+namespace lambda {
+
+  // infers the parameters a definition always reduces when it is applied to
+  // all of them, and marks the arguments passed there HeadEager when the
+  // parameter occurs more than once. such arguments would be copied
+  // unevaluated and reduced once per copy, while forcing an argument that is
+  // used once only reduces it further than needed. `{c} $a $b` demands what
+  // `c` and both of `a` and `b` demand when `c` gives `T` or `F`, that is
+  // when it is headed by `T`, `F`, `0n?` or a definition that is. a
+  // parameter counts as demanded when its head is needed, which is as far as
+  // a marked argument is reduced ahead of time
+  class StrictnessAnalyzer {
+  public:
+    struct Parameter {
+      bool is_strict;
+      // occurs more than once in the body
+      bool is_shared;
+    };
+    using Signature = std::vector<Parameter>;
+
+    StrictnessAnalyzer(Reducer& reducer);
+
+    // mark the strict arguments of `expression`, the definition of `literal`,
+    // or a query when `literal` is empty. returns the marked arguments as
+    // `{M}`, separated by spaces
+    auto annotate(
+      const std::string& literal,
+      Expression* expression
+    ) -> std::string;
+
+  private:
+    using BoundVariables = std::multiset<std::string>;
+    using Demand = std::set<std::string>;
+
+    Reducer& reducer;
+    std::map<std::string, Signature> signatures;
+    // symbols whose signatures are being inferred, taken as not strict
+    std::set<std::string> analyzing;
+    // symbols whose signatures `signature_of` inferred, in order. the ones
+    // inferred while a fixed point assumed more than it ends up with are
+    // dropped and inferred again
+    std::vector<std::string> inferred;
+    // parameters after which a symbol gives `T` or `F`, SIZE_MAX for
+    // symbols that are not known to
+    std::map<std::string, size_t> predicate_arities;
+
+    auto signature_of(const std::string& literal) -> const Signature*;
+
+    auto predicate_arity(const std::string& literal) -> size_t;
+
+    // `expression` reduces to `T` or `F`, as far as can be told
+    bool is_boolean(Expression* expression, BoundVariables& bound_variables);
+
+    auto infer_signature(
+      const std::string& literal,
+      Expression* definition
+    ) -> Signature;
+
+    auto abstraction_signature(
+      Expression* abstraction,
+      BoundVariables& bound_variables
+    ) -> Signature;
+
+    // bound variables whose heads are needed to reduce `expression` to head
+    // normal form
+    auto demanded(
+      Expression* expression,
+      BoundVariables& bound_variables
+    ) -> Demand;
+
+    void mark(
+      Expression* expression,
+      BoundVariables& bound_variables,
+      std::string& report
+    );
+  };
+
+}
+
+#endif
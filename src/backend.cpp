@@ -0,0 +1,41 @@
+#include "backend.h"
+#include "net.h"
+#include "ski.h"
+
+#include <stdexcept>
+
+namespace lambda {
+
+  static const std::map<std::string, EngineType> ENGINE_NAMES = {
+    { "tree", EngineType::Tree },
+    { "net", EngineType::Net },
+    { "ski", EngineType::Ski }
+  };
+
+  auto engine_from_name(const std::string& name) -> EngineType {
+    auto it = ENGINE_NAMES.find(name);
+    if (it == ENGINE_NAMES.end()) {
+      throw std::runtime_error("unknown engine " + name);
+    }
+    return it->second;
+  }
+
+  auto engine_name(EngineType engine_type) -> std::string {
+    for (auto& [name, type]: ENGINE_NAMES) {
+      if (type == engine_type) { return name; }
+    }
+    return "";
+  }
+
+  auto make_backend(EngineType engine_type) -> std::unique_ptr<Backend> {
+    switch (engine_type) {
+      case EngineType::Net:
+        return std::make_unique<NetBackend>();
+      case EngineType::Ski:
+        return std::make_unique<SkiBackend>();
+      default:
+        return nullptr;
+    }
+  }
+
+}
@@ -0,0 +1,92 @@
+#include "checkpoint.h"
+#include "image.h"
+
+#include <stdexcept>
+#include <cstdio>
+
+namespace lambda {
+
+  static constexpr char CHECKPOINT_MAGIC[] = "LCEC0001";
+  static constexpr size_t CHECKPOINT_MAGIC_LENGTH = sizeof(CHECKPOINT_MAGIC) - 1;
+
+  // steps between two looks at the clock
+  static constexpr unsigned long long CLOCK_INTERVAL = 1024;
+
+  Checkpoint::~Checkpoint() {
+    if (query) { query->delete_instance(); }
+    if (expression) { expression->delete_instance(); }
+    for (auto& symbol: symbols) {
+      symbol.second->delete_instance();
+    }
+  }
+
+  void read_checkpoint(const std::string& path, Checkpoint& checkpoint) {
+    MappedFile file(path);
+    if (!file.is_open()) {
+      throw std::runtime_error("cannot open checkpoint " + path);
+    }
+
+    auto cursor = file.begin();
+    auto end = file.end();
+    if (
+      (size_t)(end - cursor) < CHECKPOINT_MAGIC_LENGTH
+      || std::string(cursor, CHECKPOINT_MAGIC_LENGTH) != CHECKPOINT_MAGIC
+    ) {
+      throw std::runtime_error(path + " is no checkpoint");
+    }
+    cursor += CHECKPOINT_MAGIC_LENGTH;
+
+    checkpoint.step = read_number(cursor, end);
+    checkpoint.msec = read_number(cursor, end);
+    for (auto count = read_number(cursor, end); count > 0; count--) {
+      auto literal = read_string(cursor, end);
+      checkpoint.symbols.emplace_back(literal, read_expression(cursor, end));
+    }
+    checkpoint.query = new Root(read_expression(cursor, end));
+    checkpoint.expression = new Root(read_expression(cursor, end));
+  }
+
+
+  CheckpointWriter::CheckpointWriter(
+    const std::string& path,
+    unsigned long long steps,
+    unsigned long long seconds
+  ): path(path),
+    steps(steps),
+    interval(std::chrono::seconds(seconds)),
+    last_save(std::chrono::steady_clock::now()) {}
+
+  bool CheckpointWriter::is_due(unsigned long long step) {
+    if (steps > 0) { return step % steps == 0; }
+    if (step % CLOCK_INTERVAL != 0) { return false; }
+    return std::chrono::steady_clock::now() - last_save >= interval;
+  }
+
+  void CheckpointWriter::save(
+    Expression* query,
+    Expression* expression,
+    unsigned long long step,
+    clock_t msec,
+    std::map<std::string, Expression*>& symbol_table
+  ) {
+    auto buffer = std::string(CHECKPOINT_MAGIC);
+
+    write_number(buffer, step);
+    write_number(buffer, msec);
+    write_number(buffer, symbol_table.size());
+    for (auto& [literal, definition]: symbol_table) {
+      write_string(buffer, literal);
+      write_expression(buffer, definition);
+    }
+    write_expression(buffer, query);
+    write_expression(buffer, expression);
+
+    // the reduction it protects goes on, the next save may succeed
+    if (!replace_file(path, buffer)) {
+      fprintf(stderr, "warning: cannot write checkpoint %s\n", path.c_str());
+    }
+
+    last_save = std::chrono::steady_clock::now();
+  }
+
+}
@@ -0,0 +1,271 @@
+#include "dag.h"
+
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <set>
+
+namespace lambda {
+
+  enum class DagTag: size_t {
+    Bound = 1,
+    Free,
+    Abstraction,
+    Application,
+    Numeral,
+    Opaque
+  };
+
+  static auto combine_hash(size_t seed, size_t value) -> size_t {
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+  }
+
+  static auto unwrap_root(Expression* expression) -> Expression* {
+    while (auto root = dynamic_cast<Root*>(expression)) {
+      expression = root->get_expression();
+    }
+    return expression;
+  }
+
+  // binders and the position they are at, outermost first
+  using Binders = std::vector<std::string>;
+
+  static auto find_binder(const Binders& binders, const std::string& literal) -> size_t {
+    for (auto i = binders.size(); i-- > 0;) {
+      if (binders[i] == literal) { return i; }
+    }
+    return SIZE_MAX;
+  }
+
+  class DagBuilder {
+  public:
+    auto build(Expression* expression) -> DagForm {
+      Binders binders;
+      annotate(expression, binders);
+      count(expression);
+
+      DagForm result;
+      result.expression = print(expression, result.definitions).first;
+      return result;
+    }
+
+  private:
+    struct Info {
+      size_t hash;
+      unsigned long long size;
+      // whether every variable is bound inside, or free in the whole term
+      bool is_closed;
+    };
+
+    std::unordered_map<Expression*, Info> infos;
+    std::set<std::string> literals;
+
+    // classes of alpha equivalent closed subterms, by hash
+    std::unordered_map<size_t, std::vector<size_t>> classes;
+    std::vector<Expression*> representatives;
+    std::vector<unsigned long long> reference_counts;
+    std::unordered_map<Expression*, size_t> class_ids;
+
+    // names of the hoisted classes defined so far, and the next index
+    std::unordered_map<size_t, std::string> defined;
+    unsigned next_index = 0;
+
+    // the outermost binder referred to inside, SIZE_MAX when none is
+    auto annotate(Expression* expression, Binders& binders) -> size_t {
+      expression = unwrap_root(expression);
+      auto depth = binders.size();
+      auto outermost = SIZE_MAX;
+      Info info;
+
+      if (auto variable = dynamic_cast<Variable*>(expression)) {
+        auto& literal = variable->get_literal();
+        literals.insert(literal);
+        outermost = find_binder(binders, literal);
+        info.hash = outermost == SIZE_MAX
+          ? combine_hash((size_t)DagTag::Free, std::hash<std::string>()(literal))
+          : combine_hash((size_t)DagTag::Bound, depth - 1 - outermost);
+        info.size = 1;
+      }
+      else if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+        auto& literal = abstraction->get_binder().get_literal();
+        literals.insert(literal);
+        binders.push_back(literal);
+        outermost = annotate(abstraction->get_body(), binders);
+        binders.pop_back();
+
+        auto& body = infos[unwrap_root(abstraction->get_body())];
+        info.hash = combine_hash((size_t)DagTag::Abstraction, body.hash);
+        info.size = 1 + body.size;
+      }
+      else if (auto application = dynamic_cast<Application*>(expression)) {
+        auto first_outermost = annotate(application->get_first(), binders);
+        auto second_outermost = annotate(application->get_second(), binders);
+        outermost = std::min(first_outermost, second_outermost);
+
+        auto& first = infos[unwrap_root(application->get_first())];
+        auto& second = infos[unwrap_root(application->get_second())];
+        info.hash = combine_hash(
+          combine_hash((size_t)DagTag::Application, first.hash),
+          second.hash
+        );
+        info.size = 1 + first.size + second.size;
+      }
+      else if (auto numeral = dynamic_cast<Numeral*>(expression)) {
+        info.hash = combine_hash((size_t)DagTag::Numeral, numeral->get_value());
+        info.size = 3;
+      }
+      else {
+        // native operators and closures are printed as they are and never
+        // hoisted, whatever they refer to
+        info.hash = combine_hash(
+          (size_t)DagTag::Opaque, std::hash<std::string>()(expression->to_string())
+        );
+        info.size = 1;
+        outermost = 0;
+      }
+
+      info.is_closed = outermost == SIZE_MAX || outermost >= depth;
+      infos[expression] = info;
+      return outermost;
+    }
+
+    // a single variable or a pair of them is not worth a name
+    bool is_candidate(Expression* expression) {
+      auto& info = infos[expression];
+      return info.is_closed && info.size > 2;
+    }
+
+    static bool is_alpha_equivalent(
+      Expression* a,
+      Expression* b,
+      Binders& a_binders,
+      Binders& b_binders
+    ) {
+      a = unwrap_root(a);
+      b = unwrap_root(b);
+
+      if (auto variable = dynamic_cast<Variable*>(a)) {
+        auto other = dynamic_cast<Variable*>(b);
+        if (other == nullptr) { return false; }
+        auto position = find_binder(a_binders, variable->get_literal());
+        auto other_position = find_binder(b_binders, other->get_literal());
+        if (position != other_position) { return false; }
+        return position != SIZE_MAX || variable->get_literal() == other->get_literal();
+      }
+      if (auto abstraction = dynamic_cast<Abstraction*>(a)) {
+        auto other = dynamic_cast<Abstraction*>(b);
+        if (other == nullptr) { return false; }
+        a_binders.push_back(abstraction->get_binder().get_literal());
+        b_binders.push_back(other->get_binder().get_literal());
+        auto result = is_alpha_equivalent(
+          abstraction->get_body(), other->get_body(), a_binders, b_binders
+        );
+        a_binders.pop_back();
+        b_binders.pop_back();
+        return result;
+      }
+      if (auto application = dynamic_cast<Application*>(a)) {
+        auto other = dynamic_cast<Application*>(b);
+        return other != nullptr
+          && is_alpha_equivalent(
+            application->get_first(), other->get_first(), a_binders, b_binders
+          )
+          && is_alpha_equivalent(
+            application->get_second(), other->get_second(), a_binders, b_binders
+          );
+      }
+      if (auto numeral = dynamic_cast<Numeral*>(a)) {
+        auto other = dynamic_cast<Numeral*>(b);
+        return other != nullptr && numeral->get_value() == other->get_value();
+      }
+      return a->to_string() == b->to_string();
+    }
+
+    auto find_class(Expression* expression) -> size_t {
+      auto& ids = classes[infos[expression].hash];
+      for (auto id: ids) {
+        Binders a_binders, b_binders;
+        if (is_alpha_equivalent(expression, representatives[id], a_binders, b_binders)) {
+          return id;
+        }
+      }
+
+      ids.push_back(representatives.size());
+      representatives.push_back(expression);
+      reference_counts.push_back(0);
+      return representatives.size() - 1;
+    }
+
+    // counts the references to each class, below the first occurrence only
+    void count(Expression* expression) {
+      expression = unwrap_root(expression);
+
+      if (is_candidate(expression)) {
+        auto id = find_class(expression);
+        class_ids[expression] = id;
+        if (reference_counts[id]++ > 0) { return; }
+      }
+
+      if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+        count(abstraction->get_body());
+      }
+      else if (auto application = dynamic_cast<Application*>(expression)) {
+        count(application->get_first());
+        count(application->get_second());
+      }
+    }
+
+    // `_N` must not be a literal of the term
+    auto make_name() -> std::string {
+      while (literals.count("_" + std::to_string(next_index)) > 0) { next_index++; }
+      return "_" + std::to_string(next_index++);
+    }
+
+    // as `to_string()`, with its priority
+    auto print(
+      Expression* expression,
+      std::vector<std::string>& definitions,
+      bool is_defined = false
+    ) -> std::pair<std::string, Priority> {
+      expression = unwrap_root(expression);
+
+      auto it = class_ids.find(expression);
+      if (!is_defined && it != class_ids.end() && reference_counts[it->second] >= 2) {
+        auto id = it->second;
+        auto name = defined.find(id);
+        if (name == defined.end()) {
+          // what it refers to is defined first
+          auto body = print(expression, definitions, true).first;
+          name = defined.emplace(id, make_name()).first;
+          definitions.push_back("# " + name->second + " := " + body);
+        }
+        return { name->second, Priority::Variable };
+      }
+
+      if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+        auto [body, priority] = print(abstraction->get_body(), definitions);
+        return {
+          "\\" + abstraction->get_binder().to_string()
+            + "." + (priority > Priority::Abstraction ? " " : "") + body,
+          Priority::Abstraction
+        };
+      }
+
+      if (auto application = dynamic_cast<Application*>(expression)) {
+        auto [first, first_priority] = print(application->get_first(), definitions);
+        auto [second, second_priority] = print(application->get_second(), definitions);
+        if (first_priority < Priority::Application) { first = "(" + first + ")"; }
+        if (second_priority <= Priority::Application) { second = "(" + second + ")"; }
+        return { first + " " + second, Priority::Application };
+      }
+
+      return { expression->to_string(), expression->get_priority() };
+    }
+  };
+
+  auto to_dag_form(Expression* expression) -> DagForm {
+    return DagBuilder().build(expression);
+  }
+
+}
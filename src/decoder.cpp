@@ -0,0 +1,147 @@
+#include "decoder.h"
+
+namespace lambda {
+
+  static auto as_variable(Expression* expression) -> Variable* {
+    return dynamic_cast<Variable*>(expression);
+  }
+
+  static auto as_abstraction(Expression* expression) -> Abstraction* {
+    return dynamic_cast<Abstraction*>(expression);
+  }
+
+  static auto as_application(Expression* expression) -> Application* {
+    return dynamic_cast<Application*>(expression);
+  }
+
+  static auto unwrap_root(Expression* expression) -> Expression* {
+    while (auto root = dynamic_cast<Root*>(expression)) {
+      expression = root->get_expression();
+    }
+    return expression;
+  }
+
+  auto decode_church_number(
+    Expression* expression
+  ) -> std::optional<unsigned long long> {
+    if (auto numeral = dynamic_cast<Numeral*>(unwrap_root(expression))) {
+      return numeral->get_value();
+    }
+
+    auto outer = as_abstraction(unwrap_root(expression));
+    if (outer == nullptr) { return std::nullopt; }
+    auto inner = as_abstraction(outer->get_body());
+    if (inner == nullptr) { return std::nullopt; }
+
+    auto& f = outer->get_binder();
+    auto& x = inner->get_binder();
+    if (f == x) { return std::nullopt; }
+
+    unsigned long long number = 0;
+    auto body = inner->get_body();
+    // iteratively, numerals may be far deeper than the stack allows
+    for (auto application = as_application(body);
+      application != nullptr;
+      application = as_application(body)
+    ) {
+      auto function = as_variable(application->get_first());
+      if (function == nullptr || !(*function == f)) { return std::nullopt; }
+      body = application->get_second();
+      number++;
+    }
+
+    auto variable = as_variable(body);
+    if (variable == nullptr || !(*variable == x)) { return std::nullopt; }
+    return number;
+  }
+
+  auto decode_boolean(Expression* expression) -> std::optional<bool> {
+    if (auto numeral = dynamic_cast<Numeral*>(unwrap_root(expression))) {
+      if (numeral->get_value() == 0) { return false; }
+      return std::nullopt;
+    }
+
+    auto outer = as_abstraction(unwrap_root(expression));
+    if (outer == nullptr) { return std::nullopt; }
+    auto inner = as_abstraction(outer->get_body());
+    if (inner == nullptr) { return std::nullopt; }
+    auto variable = as_variable(inner->get_body());
+    if (variable == nullptr) { return std::nullopt; }
+
+    auto& p = outer->get_binder();
+    auto& q = inner->get_binder();
+    if (p == q) { return std::nullopt; }
+
+    if (*variable == p) { return true; }
+    if (*variable == q) { return false; }
+    return std::nullopt;
+  }
+
+  // `*`, i.e. `\x.\p.\q. p`
+  static bool is_nil(Expression* expression) {
+    auto abstraction = as_abstraction(expression);
+    return abstraction != nullptr
+      && decode_boolean(abstraction->get_body()) == true
+      && !abstraction->get_body()->is_variable_free(
+        abstraction->get_binder().get_literal()
+      );
+  }
+
+  // `[] a b`, i.e. `\p. p a b`
+  static bool decode_pair(
+    Expression* expression,
+    Expression*& head,
+    Expression*& tail
+  ) {
+    auto abstraction = as_abstraction(expression);
+    if (abstraction == nullptr) { return false; }
+    auto outer = as_application(abstraction->get_body());
+    if (outer == nullptr) { return false; }
+    auto inner = as_application(outer->get_first());
+    if (inner == nullptr) { return false; }
+    auto selector = as_variable(inner->get_first());
+    auto& p = abstraction->get_binder();
+    if (selector == nullptr || !(*selector == p)) { return false; }
+
+    head = inner->get_second();
+    tail = outer->get_second();
+    return !head->is_variable_free(p.get_literal())
+      && !tail->is_variable_free(p.get_literal());
+  }
+
+  static bool is_list(Expression* expression) {
+    Expression* head;
+    Expression* tail;
+    while (decode_pair(expression, head, tail)) { expression = tail; }
+    return is_nil(expression);
+  }
+
+  auto to_decoded_string(Expression* expression) -> std::string {
+    expression = unwrap_root(expression);
+
+    if (auto number = decode_church_number(expression)) {
+      return std::to_string(*number);
+    }
+    if (auto boolean = decode_boolean(expression)) {
+      return *boolean ? "true" : "false";
+    }
+    if (is_nil(expression)) { return "[]"; }
+
+    Expression* head;
+    Expression* tail;
+    if (!decode_pair(expression, head, tail)) {
+      return expression->to_string();
+    }
+
+    if (!is_list(tail)) {
+      return "(" + to_decoded_string(head) + ", " + to_decoded_string(tail) + ")";
+    }
+
+    auto result = "[" + to_decoded_string(head);
+    for (expression = tail; decode_pair(expression, head, tail); expression = tail) {
+      result += "," + to_decoded_string(head);
+    }
+    return result + "]";
+  }
+
+}
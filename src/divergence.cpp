@@ -0,0 +1,100 @@
+#include "divergence.h"
+
+namespace lambda {
+
+  // steps between two checks. the terms seen at those steps repeat as well
+  // once the reduction does, and the nodes made and dropped in between are
+  // never hashed
+  static constexpr unsigned long long CHECK_INTERVAL = 16;
+
+  // equal including computational priorities, which decide what is reduced
+  // next. children are compared by their hashes first
+  static bool is_same_term(Expression* a, Expression* b) {
+    if (
+      a->get_hash() != b->get_hash()
+      || a->get_size() != b->get_size()
+      || a->get_computational_priority() != b->get_computational_priority()
+    ) {
+      return false;
+    }
+
+    if (auto root = dynamic_cast<Root*>(a)) {
+      auto other = dynamic_cast<Root*>(b);
+      return other != nullptr
+        && is_same_term(root->get_expression(), other->get_expression());
+    }
+    if (auto variable = dynamic_cast<Variable*>(a)) {
+      auto other = dynamic_cast<Variable*>(b);
+      return other != nullptr && *variable == *other;
+    }
+    if (auto abstraction = dynamic_cast<Abstraction*>(a)) {
+      auto other = dynamic_cast<Abstraction*>(b);
+      return other != nullptr
+        && abstraction->get_binder() == other->get_binder()
+        && is_same_term(abstraction->get_body(), other->get_body());
+    }
+    if (auto application = dynamic_cast<Application*>(a)) {
+      auto other = dynamic_cast<Application*>(b);
+      return other != nullptr
+        && is_same_term(application->get_first(), other->get_first())
+        && is_same_term(application->get_second(), other->get_second());
+    }
+    if (auto numeral = dynamic_cast<Numeral*>(a)) {
+      auto other = dynamic_cast<Numeral*>(b);
+      return other != nullptr && numeral->get_value() == other->get_value();
+    }
+    return a->to_string() == b->to_string();
+  }
+
+  DivergenceDetector::~DivergenceDetector() {
+    if (candidate.saved != nullptr) { candidate.saved->delete_instance(); }
+  }
+
+  auto DivergenceDetector::check(
+    Expression* expression,
+    unsigned long long step
+  ) -> std::string {
+    if (step % CHECK_INTERVAL != 0) { return ""; }
+
+    // the distance is a multiple of the length of the cycle, which is not
+    // known more precisely from every 16th term
+    if (repeats(expression, step)) {
+      return "term of step " + std::to_string(candidate.step)
+        + " repeats within " + std::to_string(candidate.distance) + " steps";
+    }
+    return "";
+  }
+
+  bool DivergenceDetector::repeats(
+    Expression* expression,
+    unsigned long long step
+  ) {
+    if (candidate.saved != nullptr) {
+      if (step == candidate.step + candidate.distance) {
+        if (is_same_term(expression, candidate.saved)) { return true; }
+        // hashes that happened to be equal
+        candidate.saved->delete_instance();
+        candidate.saved = nullptr;
+      }
+    }
+    else if (
+      term.is_set
+      && expression->get_hash() == term.hash
+      && expression->get_size() == term.size
+    ) {
+      candidate.saved = expression->clone();
+      candidate.step = step;
+      candidate.distance = step - term.step;
+    }
+
+    if (step - term.step >= term.power * CHECK_INTERVAL) {
+      term.is_set = true;
+      term.hash = expression->get_hash();
+      term.size = expression->get_size();
+      term.step = step;
+      term.power *= 2;
+    }
+    return false;
+  }
+
+}
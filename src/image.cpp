@@ -0,0 +1,380 @@
+#include "image.h"
+
+#include <stdexcept>
+#include <cstdio>
+#include <climits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lambda {
+
+  static constexpr char IMAGE_MAGIC[] = "LCEI0002";
+  static constexpr size_t IMAGE_MAGIC_LENGTH = sizeof(IMAGE_MAGIC) - 1;
+
+  enum class NodeTag : char {
+    Variable = 'V',
+    Abstraction = 'L',
+    Application = 'A',
+    Numeral = 'N'
+  };
+
+  static void corrupted() {
+    throw std::runtime_error("corrupted image");
+  }
+
+  void write_number(std::string& buffer, unsigned long long number) {
+    for (; number >= 0x80; number >>= 7) {
+      buffer += (char)((number & 0x7f) | 0x80);
+    }
+    buffer += (char)number;
+  }
+
+  auto read_number(
+    const char*& cursor,
+    const char* end
+  ) -> unsigned long long {
+    unsigned long long number = 0;
+    for (unsigned shift = 0;; shift += 7) {
+      [[unlikely]] if (cursor >= end || shift >= 64) { corrupted(); }
+      auto byte = (unsigned char)*cursor++;
+      number |= (unsigned long long)(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) { return number; }
+    }
+  }
+
+  void write_string(std::string& buffer, const std::string& string) {
+    write_number(buffer, string.length());
+    buffer += string;
+  }
+
+  auto read_string(const char*& cursor, const char* end) -> std::string {
+    auto length = read_number(cursor, end);
+    [[unlikely]] if (length > (unsigned long long)(end - cursor)) { corrupted(); }
+    auto result = std::string(cursor, length);
+    cursor += length;
+    return result;
+  }
+
+  static auto read_priority(
+    const char*& cursor,
+    const char* end
+  ) -> ComputationalPriority {
+    [[unlikely]] if (cursor >= end) { corrupted(); }
+    auto priority = (ComputationalPriority)(signed char)*cursor++;
+    [[unlikely]] if (
+      priority != ComputationalPriority::Lazy
+      && priority != ComputationalPriority::Neutral
+      && priority != ComputationalPriority::Eager
+      && priority != ComputationalPriority::HeadEager
+    ) {
+      corrupted();
+    }
+    return priority;
+  }
+
+  void write_expression(std::string& buffer, Expression* expression) {
+    auto priority = (char)expression->get_computational_priority();
+
+    if (auto variable = dynamic_cast<Variable*>(expression)) {
+      buffer += (char)NodeTag::Variable;
+      buffer += priority;
+      write_string(buffer, variable->get_literal());
+    }
+    else if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      buffer += (char)NodeTag::Abstraction;
+      buffer += priority;
+      write_string(buffer, abstraction->get_binder().get_literal());
+      write_expression(buffer, abstraction->get_body());
+    }
+    else if (auto application = dynamic_cast<Application*>(expression)) {
+      buffer += (char)NodeTag::Application;
+      buffer += priority;
+      write_expression(buffer, application->get_first());
+      write_expression(buffer, application->get_second());
+    }
+    else if (auto root = dynamic_cast<Root*>(expression)) {
+      write_expression(buffer, root->get_expression());
+    }
+    // kept compact, a checkpoint may hold numerals of millions
+    else if (auto numeral = dynamic_cast<Numeral*>(expression)) {
+      buffer += (char)NodeTag::Numeral;
+      buffer += priority;
+      write_number(buffer, numeral->get_value());
+    }
+    // written as the terms they stand for
+    else if (auto primitive = dynamic_cast<Primitive*>(expression)) {
+      auto unfolded = primitive->expand();
+      write_expression(buffer, unfolded);
+      unfolded->delete_instance();
+    }
+    else if (auto closure = dynamic_cast<Closure*>(expression)) {
+      auto substituted = closure->substitute();
+      write_expression(buffer, substituted);
+      substituted->delete_instance();
+    }
+    else {
+      throw std::runtime_error("expression cannot be written to image");
+    }
+  }
+
+  auto read_expression(const char*& cursor, const char* end) -> Expression* {
+    [[unlikely]] if (cursor >= end) { corrupted(); }
+    auto tag = (NodeTag)*cursor++;
+    auto priority = read_priority(cursor, end);
+
+    switch (tag) {
+      case NodeTag::Variable: {
+        return new Variable(read_string(cursor, end), priority);
+      }
+      case NodeTag::Abstraction: {
+        auto binder = read_string(cursor, end);
+        return new Abstraction(
+          Variable(binder),
+          read_expression(cursor, end),
+          priority
+        );
+      }
+      case NodeTag::Application: {
+        auto first = read_expression(cursor, end);
+        auto second = read_expression(cursor, end);
+        return new Application(first, second, priority);
+      }
+      case NodeTag::Numeral: {
+        auto value = read_number(cursor, end);
+        [[unlikely]] if (value > UINT_MAX) { corrupted(); }
+        return new Numeral((unsigned)value, priority);
+      }
+      default: corrupted(); return nullptr;
+    }
+  }
+
+
+  MappedFile::MappedFile(const std::string& path)
+    : data(MAP_FAILED), size(0) {
+    auto fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) { return; }
+
+    struct stat status;
+    if (fstat(fd, &status) == 0 && status.st_size > 0) {
+      size = status.st_size;
+      data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+  }
+
+  MappedFile::~MappedFile() {
+    if (data != MAP_FAILED) { munmap(data, size); }
+  }
+
+  bool MappedFile::is_open() { return data != MAP_FAILED; }
+  auto MappedFile::begin() -> const char* { return (const char*)data; }
+  auto MappedFile::end() -> const char* { return (const char*)data + size; }
+
+
+  bool replace_file(const std::string& path, const std::string& buffer) {
+    auto slash = path.find_last_of('/');
+    auto folder = slash == std::string::npos
+      ? std::string(".")
+      : path.substr(0, slash + 1);
+
+    // unique, so that runs saving the same file do not write into each other
+    auto temporary_path = path + ".XXXXXX";
+    auto fd = mkstemp(temporary_path.data());
+    if (fd < 0) { return false; }
+
+    // mkstemp leaves the file to its owner, as fopen would not
+    auto mask = umask(0);
+    umask(mask);
+    auto is_written = fchmod(fd, 0666 & ~mask) == 0;
+
+    for (size_t offset = 0; is_written && offset < buffer.size();) {
+      auto count = write(fd, buffer.data() + offset, buffer.size() - offset);
+      is_written = count > 0;
+      if (is_written) { offset += count; }
+    }
+    is_written = is_written && fsync(fd) == 0;
+    is_written = close(fd) == 0 && is_written;
+
+    if (!is_written || rename(temporary_path.c_str(), path.c_str()) != 0) {
+      unlink(temporary_path.c_str());
+      return false;
+    }
+
+    // the new name is only durable once the folder holding it is
+    auto folder_fd = open(folder.c_str(), O_RDONLY | O_DIRECTORY);
+    if (folder_fd < 0) { return false; }
+    auto is_synced = fsync(folder_fd) == 0;
+    close(folder_fd);
+    return is_synced;
+  }
+
+  auto image_path(const std::string& source_path) -> std::string {
+    return source_path + "c";
+  }
+
+  static bool is_newer(const std::string& path, const std::string& than) {
+    struct stat status, than_status;
+    if (stat(path.c_str(), &status) != 0) { return false; }
+    if (stat(than.c_str(), &than_status) != 0) { return false; }
+
+    return status.st_mtim.tv_sec != than_status.st_mtim.tv_sec
+      ? status.st_mtim.tv_sec > than_status.st_mtim.tv_sec
+      : status.st_mtim.tv_nsec >= than_status.st_mtim.tv_nsec;
+  }
+
+  // header of an image: magic, then the imported source files
+  static bool read_imports(
+    const char*& cursor,
+    const char* end,
+    std::vector<std::string>& imports
+  ) {
+    if ((size_t)(end - cursor) < IMAGE_MAGIC_LENGTH) { return false; }
+    if (std::string(cursor, IMAGE_MAGIC_LENGTH) != IMAGE_MAGIC) { return false; }
+    cursor += IMAGE_MAGIC_LENGTH;
+
+    for (auto count = read_number(cursor, end); count > 0; count--) {
+      imports.push_back(read_string(cursor, end));
+    }
+    return true;
+  }
+
+  static bool is_image_fresh(const std::string& source_path) {
+    auto path = image_path(source_path);
+    if (!is_newer(path, source_path)) { return false; }
+
+    MappedFile file(path);
+    if (!file.is_open()) { return false; }
+
+    auto cursor = file.begin();
+    std::vector<std::string> imports;
+    if (!read_imports(cursor, file.end(), imports)) { return false; }
+
+    for (auto& imported_path: imports) {
+      if (!is_image_fresh(imported_path)) { return false; }
+    }
+    return true;
+  }
+
+  static void register_image(
+    const std::string& source_path,
+    Reducer& reducer,
+    bool is_lazy,
+    const std::function<void(const std::string&, Expression*&)>& define
+  ) {
+    // kept mapped while deferred symbols may still be decoded from it
+    auto file = std::make_shared<MappedFile>(image_path(source_path));
+    if (!file->is_open()) { corrupted(); }
+
+    auto cursor = file->begin();
+    std::vector<std::string> imports;
+    if (!read_imports(cursor, file->end(), imports)) { corrupted(); }
+
+    for (auto& imported_path: imports) {
+      register_image(imported_path, reducer, is_lazy, define);
+    }
+
+    // decoded straight from the mapping
+    for (auto count = read_number(cursor, file->end()); count > 0; count--) {
+      auto literal = read_string(cursor, file->end());
+      auto length = read_number(cursor, file->end());
+      [[unlikely]] if (length > (unsigned long long)(file->end() - cursor)) {
+        corrupted();
+      }
+      auto begin = cursor;
+      cursor += length;
+
+      if (is_lazy) {
+        reducer.defer_symbol(literal, nullptr, [file, begin, length]() {
+          auto cursor = begin;
+          return read_expression(cursor, begin + length);
+        }, [define, literal](Expression* expression) {
+          define(literal, expression);
+        });
+      }
+      else {
+        auto expression = read_expression(begin, cursor);
+        define(literal, expression);
+      }
+    }
+  }
+
+  bool load_image(
+    const std::string& source_path,
+    Reducer& reducer,
+    bool is_lazy,
+    const std::function<void(const std::string&, Expression*&)>& define
+  ) {
+    if (!is_image_fresh(source_path)) { return false; }
+    register_image(source_path, reducer, is_lazy, define);
+    return true;
+  }
+
+
+  void ImageBuilder::begin(const std::string& source_path) {
+    clear(images[source_path]);
+  }
+
+  void ImageBuilder::add_import(
+    const std::string& source_path,
+    const std::string& imported_path
+  ) {
+    auto it = images.find(source_path);
+    if (it == images.end()) { return; }
+    it->second.imports.push_back(imported_path);
+  }
+
+  void ImageBuilder::add_symbol(
+    const std::string& source_path,
+    const std::string& literal,
+    Expression* expression
+  ) {
+    auto it = images.find(source_path);
+    if (it == images.end()) { return; }
+    it->second.symbols.emplace_back(literal, expression->clone());
+  }
+
+  void ImageBuilder::save() {
+    for (auto& [source_path, image]: images) {
+      auto buffer = std::string(IMAGE_MAGIC);
+
+      write_number(buffer, image.imports.size());
+      for (auto& imported_path: image.imports) {
+        write_string(buffer, imported_path);
+      }
+
+      write_number(buffer, image.symbols.size());
+      // each definition is preceded by its length, so that deferred
+      // symbols are skipped without being decoded
+      std::string definition;
+      for (auto& [literal, expression]: image.symbols) {
+        write_string(buffer, literal);
+        definition.clear();
+        write_expression(definition, expression);
+        write_string(buffer, definition);
+      }
+
+      // an image is only a cache, a source without one is parsed again
+      auto path = image_path(source_path);
+      if (!replace_file(path, buffer)) {
+        fprintf(stderr, "warning: cannot write image %s\n", path.c_str());
+      }
+    }
+  }
+
+  void ImageBuilder::clear(Image& image) {
+    image.imports.clear();
+    for (auto& symbol: image.symbols) {
+      symbol.second->delete_instance();
+    }
+    image.symbols.clear();
+  }
+
+  ImageBuilder::~ImageBuilder() {
+    for (auto& image: images) {
+      clear(image.second);
+    }
+  }
+
+}
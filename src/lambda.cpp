@@ -1,8 +1,21 @@
 #include "lambda.h"
+#include "native.h"
+#include "decoder.h"
+#include "dag.h"
+#include "strategy.h"
+#include "stream.h"
+#include "divergence.h"
+#include "backend.h"
+#include "checkpoint.h"
+#include "progress.h"
 
 #include <ctime>
 #include <functional>
 #include <cassert>
+#include <typeinfo>
+#include <algorithm>
+#include <stdexcept>
+#include <climits>
 
 namespace lambda {
 
@@ -17,7 +30,7 @@ namespace lambda {
   }
 
   template <template<typename...> typename Container, typename T, typename... Ts>
-  static bool has(Container<T, Ts...>& container, T& element) {
+  static bool has(Container<T, Ts...>& container, const T& element) {
     return container.count(element) > 0;
   }
 
@@ -33,6 +46,23 @@ namespace lambda {
     return result;
   }
 
+  // push pending substitutions down until `expression` is no closure.
+  // nothing is looked for outside the explicit substitution mode and once
+  // all closures are pushed out
+  static void push_closures(
+    Expression*& expression,
+    std::multiset<std::string>& bound_variables,
+    ExplicitSubstitution* substitution
+  ) {
+    [[likely]] if (!substitution || substitution->closure_count == 0) { return; }
+
+    // called on every node the reduction looks at, typeid is cheaper than
+    // dynamic_cast
+    while (typeid(*expression) == typeid(Closure)) {
+      expression = static_cast<Closure*>(expression)->push(bound_variables);
+    }
+  }
+
   static bool is_number(std::string s) {
     for (auto ch: s) {
       [[likely]] if (ch < '0' || ch > '9') { return false; }
@@ -40,12 +70,92 @@ namespace lambda {
     return true;
   }
 
+  // the value of a literal for which is_number holds
+  static auto to_number(const std::string& literal) -> unsigned {
+    unsigned long long value = 0;
+    for (auto ch: literal) {
+      value = value * 10 + (ch - '0');
+      [[unlikely]] if (value > UINT_MAX) {
+        throw std::runtime_error("numeral " + literal + " is too large");
+      }
+    }
+    return value;
+  }
+
+  // `\x1...\xn. y M1 ... Mk` with `y` bound, whose head no step changes.
+  // free variables are taken as symbols still to be unfolded
+  static bool is_in_head_normal_form(
+    Expression* expression,
+    std::multiset<std::string>& bound_variables
+  ) {
+    std::vector<const std::string*> binders;
+    while (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      if (abstraction->is_in_normal_form()) { return true; }
+      binders.push_back(&abstraction->get_binder().get_literal());
+      expression = abstraction->get_body();
+    }
+
+    auto is_applied = false;
+    while (auto application = dynamic_cast<Application*>(expression)) {
+      if (application->is_in_normal_form()) { return true; }
+      expression = application->get_first();
+      is_applied = true;
+    }
+
+    if (auto variable = dynamic_cast<Variable*>(expression)) {
+      for (auto binder: binders) {
+        if (*binder == variable->get_literal()) { return true; }
+      }
+      return has(bound_variables, variable->get_literal());
+    }
+    return !is_applied && dynamic_cast<Numeral*>(expression) != nullptr;
+  }
+
+  // whether the mark of `expression` asks for it to be reduced ahead of the
+  // rest, regardless of its subterms
+  static bool is_marked_eager(
+    Expression* expression,
+    ComputationalPriority priority,
+    std::multiset<std::string>& bound_variables
+  ) {
+    [[likely]] if (priority != ComputationalPriority::HeadEager) {
+      return priority == ComputationalPriority::Eager;
+    }
+    return !is_in_head_normal_form(expression, bound_variables);
+  }
+
 
   Expression::Expression(ComputationalPriority computational_priority)
     : computational_priority_flag(computational_priority),
       is_is_eager_flag_updated(false),
       is_eager_flag(false), 
-      is_normal_form(false) {}
+      is_normal_form(false),
+      is_hash_updated(false),
+      hash_value(0),
+      size_value(0) {
+    live_count++;
+  }
+
+  Expression::Expression(const Expression& other)
+    : computational_priority_flag(other.computational_priority_flag),
+      is_is_eager_flag_updated(other.is_is_eager_flag_updated),
+      is_eager_flag(other.is_eager_flag),
+      is_normal_form(other.is_normal_form),
+      is_hash_updated(other.is_hash_updated),
+      hash_value(other.hash_value),
+      size_value(other.size_value) {
+    live_count++;
+  }
+
+  Expression::~Expression() {
+    live_count--;
+  }
+
+  unsigned long long Expression::live_count = 0;
+
+  auto Expression::get_live_count() -> unsigned long long {
+    return live_count;
+  }
 
   void Expression::set_computational_priority(
     ComputationalPriority computational_priority
@@ -56,10 +166,22 @@ namespace lambda {
     computational_priority_flag = computational_priority;
   }
 
+  auto Expression::get_computational_priority() -> ComputationalPriority {
+    return computational_priority_flag;
+  }
+
   bool Expression::is_lazy() {
     return computational_priority_flag == ComputationalPriority::Lazy;
   }
 
+  bool Expression::is_in_normal_form() {
+    return is_normal_form;
+  }
+
+  void Expression::set_normal_form() {
+    is_normal_form = true;
+  }
+
   bool Expression::is_eager(
     std::multiset<std::string>& bound_variables
   ) {
@@ -71,6 +193,40 @@ namespace lambda {
     return is_variable_free(literal);
   }
 
+  auto Expression::get_hash() -> size_t {
+    update_hash();
+    return hash_value;
+  }
+
+  auto Expression::get_size() -> unsigned long long {
+    update_hash();
+    return size_value;
+  }
+
+  void Expression::invalidate_hash() {
+    is_hash_updated = false;
+  }
+
+  void Expression::copy_hash(Expression& other) {
+    is_hash_updated = other.is_hash_updated;
+    hash_value = other.hash_value;
+    size_value = other.size_value;
+  }
+
+  // node kinds, so that e.g. `\x. x` and `x x` hash differently
+  enum class HashTag: size_t {
+    Variable = 1,
+    Abstraction,
+    Application,
+    Numeral,
+    Primitive,
+    Closure
+  };
+
+  static auto combine_hash(size_t seed, size_t value) -> size_t {
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+  }
+
 
   Root::Root(Expression* expression)
     : Expression(ComputationalPriority::Neutral),
@@ -83,9 +239,15 @@ namespace lambda {
 
   auto Root::reduce(
     std::map<std::string, Expression*>& symbol_table,
-    std::multiset<std::string>& bound_variables
+    std::multiset<std::string>& bound_variables,
+    ExplicitSubstitution* substitution
   ) -> std::pair<Expression*, ReduceType> {
-    auto [new_expr, reduce_type] = expression->reduce(symbol_table, bound_variables);
+    push_closures(expression, bound_variables, substitution);
+    auto [new_expr, reduce_type] = expression->reduce(
+      symbol_table,
+      bound_variables,
+      substitution
+    );
     return { new Root(new_expr), reduce_type };
   }
 
@@ -125,6 +287,7 @@ namespace lambda {
     
     result->is_is_eager_flag_updated = is_is_eager_flag_updated;
     result->is_eager_flag = is_eager_flag;
+    result->copy_hash(*this);
 
     result->set_computational_priority(new_computational_priority);
 
@@ -142,6 +305,16 @@ namespace lambda {
     if (is_is_eager_flag_updated) { return; }
     is_is_eager_flag_updated = true;
   }
+  void Root::update_hash() {
+    if (is_hash_updated) { return; }
+    is_hash_updated = true;
+
+    hash_value = expression->get_hash();
+    size_value = expression->get_size();
+  }
+
+
+  auto Root::get_expression() -> Expression*& { return expression; }
 
   Variable::Variable(
     std::string literal, 
@@ -163,7 +336,8 @@ namespace lambda {
 
   auto Variable::reduce(
     std::map<std::string, Expression*>& symbol_table,
-    std::multiset<std::string>& bound_variables
+    std::multiset<std::string>& bound_variables,
+    ExplicitSubstitution* substitution
   ) -> std::pair<Expression*, ReduceType> {
     if (is_normal_form) { 
       return { this, ReduceType::Null }; 
@@ -179,7 +353,7 @@ namespace lambda {
     }
 
     [[unlikely]] if (is_number(literal)) {
-      auto new_expr = generate_church_number(atoi(literal.c_str()));
+      auto new_expr = new Numeral(to_number(literal));
       new_expr->set_computational_priority(computational_priority_flag);
       delete this;
       return { new_expr, ReduceType::Delta };
@@ -232,12 +406,15 @@ namespace lambda {
   auto Variable::clone(
     ComputationalPriority new_computational_priority
   ) -> Expression* {
-    auto result = new Variable(literal);
+    // made with the priority of this, so that the cached eager flag is
+    // dropped below when the new priority differs, as in the other clones
+    auto result = new Variable(literal, computational_priority_flag);
 
     result->is_normal_form = is_normal_form;
 
     result->is_is_eager_flag_updated = is_is_eager_flag_updated;
     result->is_eager_flag = is_eager_flag;
+    result->copy_hash(*this);
 
     result->set_computational_priority(new_computational_priority);
 
@@ -257,11 +434,22 @@ namespace lambda {
     is_eager_flag = 
       !is_normal_form
       && !is_lazy()
-      && computational_priority_flag == ComputationalPriority::Eager
+      && is_marked_eager(this, computational_priority_flag, bound_variables)
       && !has(bound_variables, literal) 
       && !is_number(literal)
     ;
   }
+  void Variable::update_hash() {
+    if (is_hash_updated) { return; }
+    is_hash_updated = true;
+
+    hash_value = combine_hash(
+      (size_t)HashTag::Variable,
+      std::hash<std::string>()(literal)
+    );
+    size_value = 1;
+  }
+
 
   Abstraction::Abstraction(
     Variable binder,
@@ -290,7 +478,8 @@ namespace lambda {
 
   auto Abstraction::reduce(
     std::map<std::string, Expression*>& symbol_table,
-    std::multiset<std::string>& bound_variables
+    std::multiset<std::string>& bound_variables,
+    ExplicitSubstitution* substitution
   ) -> std::pair<Expression*, ReduceType> {
     if (is_normal_form) { 
       return { this, ReduceType::Null }; 
@@ -302,17 +491,20 @@ namespace lambda {
 
     ReduceType reduce_type;
     auto it = bound_variables.emplace(binder.get_literal());
+    push_closures(body, bound_variables, substitution);
     std::tie(body, reduce_type) = body->reduce(
       symbol_table,
-      bound_variables
+      bound_variables,
+      substitution
     );
     bound_variables.erase(it);
 
-    if ((bool)reduce_type) {
-      auto new_expr = new Abstraction(binder, body, computational_priority_flag);
-      delete this;
-      return { new_expr, reduce_type };
-    }
+    // kept in place, as applications are, so that StreamPrinter can hold on
+    // to what it has printed. even without a step the body may have been
+    // replaced, see Primitive::reduce
+    is_is_eager_flag_updated = false;
+    is_hash_updated = false;
+    if ((bool)reduce_type) { return { this, reduce_type }; }
 
     set_computational_priority(ComputationalPriority::Neutral);
     is_normal_form = true;
@@ -335,6 +527,7 @@ namespace lambda {
           !has(bound_variables, new_literal) 
           && new_literal != binder.get_literal()
           && !expression.is_variable_free(new_literal)
+          && !body->is_variable_free(new_literal)
         ) {
           return this->alpha_reduce(
             Variable(new_literal)
@@ -359,6 +552,7 @@ namespace lambda {
     if ((bool)reduce_type) {
       is_normal_form = false;
       is_is_eager_flag_updated = false;
+      is_hash_updated = false;
     }
 
     return { this, reduce_type };
@@ -381,6 +575,22 @@ namespace lambda {
     return { result, ReduceType::Beta };
   }
 
+  auto Abstraction::apply_later(
+    Expression* expression,
+    ExplicitSubstitution& substitution
+  ) -> Expression* {
+    auto result = new Closure(
+      body,
+      binder,
+      expression,
+      substitution,
+      computational_priority_flag
+    );
+
+    delete this;
+    return result;
+  }
+
   auto Abstraction::to_string() -> std::string {
     return
       "\\" + binder.to_string()
@@ -399,12 +609,17 @@ namespace lambda {
   auto Abstraction::clone(
     ComputationalPriority new_computational_priority
   ) -> Expression* {
-    auto result = new Abstraction(binder, body->clone());
+    auto result = new Abstraction(
+      binder,
+      body->clone(),
+      computational_priority_flag
+    );
 
     result->is_normal_form = is_normal_form;
 
     result->is_is_eager_flag_updated = is_is_eager_flag_updated;
     result->is_eager_flag = is_eager_flag;
+    result->copy_hash(*this);
 
     result->set_computational_priority(new_computational_priority);
 
@@ -424,9 +639,26 @@ namespace lambda {
 
     is_eager_flag = 
       !is_normal_form
-      && computational_priority_flag == ComputationalPriority::Eager;
+      && is_marked_eager(this, computational_priority_flag, bound_variables);
+  }
+  void Abstraction::update_hash() {
+    if (is_hash_updated) { return; }
+    is_hash_updated = true;
+
+    hash_value = combine_hash(
+      combine_hash(
+        (size_t)HashTag::Abstraction,
+        std::hash<std::string>()(binder.get_literal())
+      ),
+      body->get_hash()
+    );
+    size_value = 1 + body->get_size();
   }
 
+
+  auto Abstraction::get_binder() -> Variable& { return binder; }
+  auto Abstraction::get_body() -> Expression*& { return body; }
+
   Application::Application(
     Expression* first,
     Expression* second,
@@ -441,35 +673,46 @@ namespace lambda {
 
   auto Application::reduce_first(
     std::map<std::string, Expression*>& symbol_table,
-    std::multiset<std::string>& bound_variables
+    std::multiset<std::string>& bound_variables,
+    ExplicitSubstitution* substitution
   ) -> std::pair<bool, ReduceType> {
     ReduceType reduce_type;
-    std::tie(first, reduce_type) = first->reduce(symbol_table, bound_variables);
+    std::tie(first, reduce_type) = first->reduce(
+      symbol_table,
+      bound_variables,
+      substitution
+    );
 
-    if ((bool)reduce_type) {
-      is_is_eager_flag_updated = false;
-    }
+    // even without a step it may have been replaced, see Primitive::reduce
+    is_is_eager_flag_updated = false;
+    is_hash_updated = false;
 
     return { (bool)reduce_type, reduce_type };
   }
 
   auto Application::reduce_second(
     std::map<std::string, Expression*>& symbol_table,
-    std::multiset<std::string>& bound_variables
+    std::multiset<std::string>& bound_variables,
+    ExplicitSubstitution* substitution
   ) -> std::pair<bool, ReduceType> {
     ReduceType reduce_type;
-    std::tie(second, reduce_type) = second->reduce(symbol_table, bound_variables);
+    std::tie(second, reduce_type) = second->reduce(
+      symbol_table,
+      bound_variables,
+      substitution
+    );
 
-    if ((bool)reduce_type) {
-      is_is_eager_flag_updated = false;
-    }
+    // even without a step it may have been replaced, see Primitive::reduce
+    is_is_eager_flag_updated = false;
+    is_hash_updated = false;
 
     return { (bool)reduce_type, reduce_type };
   }
 
   auto Application::reduce(
     std::map<std::string, Expression*>& symbol_table,
-    std::multiset<std::string>& bound_variables
+    std::multiset<std::string>& bound_variables,
+    ExplicitSubstitution* substitution
   ) -> std::pair<Expression*, ReduceType> {
     if (is_normal_form) { 
       return { this, ReduceType::Null }; 
@@ -479,34 +722,45 @@ namespace lambda {
       set_computational_priority(ComputationalPriority::Neutral);
     }
 
+    push_closures(first, bound_variables, substitution);
+    push_closures(second, bound_variables, substitution);
+
     if (first->is_eager(bound_variables)) {
-      auto [reduced, reduce_type] = reduce_first(symbol_table, bound_variables);
+      auto [reduced, reduce_type] = reduce_first(
+        symbol_table, bound_variables, substitution
+      );
       if (reduced) return { this, reduce_type };
     }
     if (second->is_eager(bound_variables)) {
-      auto [reduced, reduce_type] = reduce_second(symbol_table, bound_variables);
+      auto [reduced, reduce_type] = reduce_second(
+        symbol_table, bound_variables, substitution
+      );
       if (reduced) return { this, reduce_type };
     }
 
-    auto [new_expr, reduce_type] = first->apply(*second, bound_variables);
-    if ((bool)reduce_type) {
-      new_expr->set_computational_priority(computational_priority_flag);
-      delete this;
-      return {new_expr, reduce_type};
-    }
+    auto [new_expr, reduce_type] = contract(bound_variables, substitution);
+    if ((bool)reduce_type) { return { new_expr, reduce_type }; }
 
     if (first->is_lazy()) {
-      auto [reduced, reduce_type] = reduce_second(symbol_table, bound_variables);
+      auto [reduced, reduce_type] = reduce_second(
+        symbol_table, bound_variables, substitution
+      );
       if (reduced) return { this, reduce_type };
 
-      std::tie(reduced, reduce_type) = reduce_first(symbol_table, bound_variables);
+      std::tie(reduced, reduce_type) = reduce_first(
+        symbol_table, bound_variables, substitution
+      );
       if (reduced) return { this, reduce_type };
     }
     else {
-      auto [reduced, reduce_type] = reduce_first(symbol_table, bound_variables);
+      auto [reduced, reduce_type] = reduce_first(
+        symbol_table, bound_variables, substitution
+      );
       if (reduced) return { this, reduce_type };
 
-      std::tie(reduced, reduce_type) = reduce_second(symbol_table, bound_variables);
+      std::tie(reduced, reduce_type) = reduce_second(
+        symbol_table, bound_variables, substitution
+      );
       if (reduced) return { this, reduce_type };
     }
 
@@ -515,6 +769,29 @@ namespace lambda {
     return { this, ReduceType::Null };
   }
 
+  auto Application::contract(
+    std::multiset<std::string>& bound_variables,
+    ExplicitSubstitution* substitution
+  ) -> std::pair<Expression*, ReduceType> {
+    [[unlikely]] if (substitution) {
+      if (auto abstraction = dynamic_cast<Abstraction*>(first)) {
+        auto new_expr = abstraction->apply_later(second, *substitution);
+        new_expr->set_computational_priority(computational_priority_flag);
+        delete this;
+        return { new_expr, ReduceType::Beta };
+      }
+    }
+
+    auto [new_expr, reduce_type] = first->apply(*second, bound_variables);
+    if (!(bool)reduce_type) { return { this, reduce_type }; }
+
+    // `apply` copies what it substitutes, the argument is not used anymore
+    second->delete_instance();
+    new_expr->set_computational_priority(computational_priority_flag);
+    delete this;
+    return { new_expr, reduce_type };
+  }
+
   auto Application::replace(
     Variable& variable,
     Expression& expression,
@@ -537,6 +814,7 @@ namespace lambda {
     if ((bool)first_reduce_type || (bool) second_reduce_type) {
       is_normal_form = false;
       is_is_eager_flag_updated = false;
+      is_hash_updated = false;
     }
 
     return {
@@ -547,11 +825,22 @@ namespace lambda {
     };
   }
 
+  // `P M N` with a native operator P that takes two more arguments is
+  // contracted at once, so that collecting M is not a step of its own
   auto Application::apply(
     Expression& expression,
     std::multiset<std::string>& bound_variables
   ) -> std::pair<Expression*, ReduceType> {
-    return { this, ReduceType::Null };
+    [[likely]] if (typeid(*first) != typeid(Primitive)) {
+      return { this, ReduceType::Null };
+    }
+    auto primitive = static_cast<Primitive*>(first);
+    if (primitive->get_missing_count() != 2) { return { this, ReduceType::Null }; }
+
+    primitive->collect(second);
+    auto result = primitive->apply(expression, bound_variables);
+    delete this;
+    return result;
   }
 
   auto Application::to_string() -> std::string {
@@ -582,12 +871,17 @@ namespace lambda {
   auto Application::clone(
     ComputationalPriority new_computational_priority
   ) -> Expression* {
-    auto result = new Application(first->clone(), second->clone());
+    auto result = new Application(
+      first->clone(),
+      second->clone(),
+      computational_priority_flag
+    );
 
     result->is_normal_form = is_normal_form;
     
     result->is_is_eager_flag_updated = is_is_eager_flag_updated;
     result->is_eager_flag = is_eager_flag;
+    result->copy_hash(*this);
 
     result->set_computational_priority(new_computational_priority);
 
@@ -609,110 +903,1409 @@ namespace lambda {
       !is_normal_form
       && !is_lazy()
       && (
-        computational_priority_flag == ComputationalPriority::Eager
+        is_marked_eager(this, computational_priority_flag, bound_variables)
         || first->is_eager(bound_variables) 
         || second->is_eager(bound_variables)
       )
     ;
   }
+  void Application::update_hash() {
+    if (is_hash_updated) { return; }
+    is_hash_updated = true;
 
-
-  static auto generate_church_number_body(unsigned number) -> Expression* {
-    [[unlikely]] if (number == 0) { return new Variable("x"); }
-
-    return new Application(
-      new Variable("f"),
-      generate_church_number_body(number - 1)
+    hash_value = combine_hash(
+      combine_hash((size_t)HashTag::Application, first->get_hash()),
+      second->get_hash()
     );
+    size_value = 1 + first->get_size() + second->get_size();
   }
 
-  auto generate_church_number(unsigned number) -> Expression* {
-    return new Abstraction(
-      Variable("f"),
-      new Abstraction(
-        Variable("x"),
-        generate_church_number_body(number)
-      )
-    );
+
+  auto Application::get_first() -> Expression*& { return first; }
+  auto Application::get_second() -> Expression*& { return second; }
+
+  Numeral::Numeral(
+    unsigned value,
+    ComputationalPriority computational_priority
+  ): Expression(computational_priority), value(value) {}
+
+  void Numeral::delete_instance() {
+    delete this;
   }
 
-  static std::string reduce_type_to_header(ReduceType reduce_type) {
-    switch (reduce_type) {
-      [[unlikely]] case ReduceType::Alpha: return "alpha> ";
-      [[likely]] case ReduceType::Beta: return "beta>  ";
-      case ReduceType::Delta: return "delta> ";
-      default: assert(false); return "";
+  auto Numeral::reduce(
+    std::map<std::string, Expression*>& symbol_table,
+    std::multiset<std::string>& bound_variables,
+    ExplicitSubstitution* substitution
+  ) -> std::pair<Expression*, ReduceType> {
+    if (is_normal_form) { 
+      return { this, ReduceType::Null }; 
     }
+
+    set_computational_priority(ComputationalPriority::Neutral);
+    is_normal_form = true;
+    return { this, ReduceType::Null };
   }
 
-  static void string_println(std::string& s, FILE* out) {
-    fprintf(out, "%s\n", s.c_str());
+  auto Numeral::replace(
+    Variable& variable,
+    Expression& expression,
+    std::multiset<std::string>& bound_variables
+  ) -> std::pair<Expression*, ReduceType> {
+    return { this, ReduceType::Null };
   }
 
-  static void string_println(std::string&& s, FILE* out) {
-    fprintf(out, "%s\n", s.c_str());
+  auto Numeral::apply(
+    Expression& expression,
+    std::multiset<std::string>& bound_variables
+  ) -> std::pair<Expression*, ReduceType> {
+    auto church_number = expand();
+    delete this;
+    return church_number->apply(expression, bound_variables);
   }
 
-  clock_t msec_count(std::function<void(void)> func) {
-    auto start_time = clock();
-    func();
-    auto end_time = clock();
-    return (end_time - start_time) / (double)CLOCKS_PER_SEC * 1000;
+  auto Numeral::to_string() -> std::string {
+    [[unlikely]] if (value == 0) { return "\\f.\\x. x"; }
+
+    auto result = std::string("\\f.\\x. ");
+    for (unsigned i = 1; i < value; i++) { result += "f ("; }
+    result += "f x";
+    result.append(value - 1, ')');
+    return result;
   }
 
-  auto Reducer::reduce(
-     Expression* expression, FILE* out, bool display_process
+  auto Numeral::get_priority() -> Priority {
+    return Priority::Abstraction;
+  }
+
+  auto Numeral::clone() -> Expression* {
+    return this->clone(computational_priority_flag);
+  }
+  auto Numeral::clone(
+    ComputationalPriority new_computational_priority
   ) -> Expression* {
+    auto result = new Numeral(value, computational_priority_flag);
 
-    string_println(expression->to_string(), out);
-    fprintf(out, "\n");
-    
-    auto expr = expression->clone();
+    result->is_normal_form = is_normal_form;
 
-    unsigned long long step;
-    unsigned long long character_count = 0;
+    result->is_is_eager_flag_updated = is_is_eager_flag_updated;
+    result->is_eager_flag = is_eager_flag;
+    result->copy_hash(*this);
+
+    result->set_computational_priority(new_computational_priority);
+
+    return result;
+  }
 
-    auto msec = msec_count([&]() {
-      for (step = 0;; step++) {
-        std::multiset<std::string> bound_variables;
-        ReduceType reduce_type;
-        std::tie(expr, reduce_type) = expr->reduce(symbol_table, bound_variables);
+  bool Numeral::is_variable_free(const std::string& literal) {
+    return false;
+  }
 
-        [[unlikely]] if (reduce_type == ReduceType::Null) { break; }
+  void Numeral::update_eager_flag(
+    std::multiset<std::string>& bound_variables
+  ) {
+    if (is_is_eager_flag_updated) { return; }
+    is_is_eager_flag_updated = true;
 
-        if (display_process) {
-          auto&& str = reduce_type_to_header(reduce_type) + expr->to_string();
-          character_count += str.length();
-          string_println(str, out);
-        }
-      }
-    });
+    is_eager_flag = 
+      !is_normal_form
+      && is_marked_eager(this, computational_priority_flag, bound_variables);
+  }
+  void Numeral::update_hash() {
+    if (is_hash_updated) { return; }
+    is_hash_updated = true;
 
-    fprintf(out, "\n");
-    string_println("to be sought:     " + expression->to_string(), out);
-    string_println("result:           " + expr->to_string(), out);
-    string_println("step taken:       " + std::to_string(step), out);
-    if (display_process) {
-      string_println("character count:  " + std::to_string(character_count), out);
+    hash_value = combine_hash((size_t)HashTag::Numeral, value);
+    size_value = 1;
+  }
+
+
+  auto Numeral::get_value() -> unsigned { return value; }
+
+  auto Numeral::expand() -> Expression* {
+    auto result = generate_church_number(value);
+    result->set_computational_priority(computational_priority_flag);
+    return result;
+  }
+
+  Primitive::Primitive(
+    const NativeOperator* native_operator,
+    std::shared_ptr<Expression> definition,
+    ComputationalPriority computational_priority
+  ): Expression(computational_priority),
+    native_operator(native_operator),
+    definition(definition) {}
+
+  void Primitive::delete_instance() {
+    for (auto argument: arguments) { argument->delete_instance(); }
+    delete this;
+  }
+
+  // everywhere but in function position the definition is unfolded, so that
+  // the normal form is the one reached without native operators. the delta
+  // reduction that made this stands for the unfolding, which is done along
+  // with the step after it, if any. the term returned then is never this one
+  auto Primitive::reduce(
+    std::map<std::string, Expression*>& symbol_table,
+    std::multiset<std::string>& bound_variables,
+    ExplicitSubstitution* substitution
+  ) -> std::pair<Expression*, ReduceType> {
+    return instantiate(bound_variables)->reduce(
+      symbol_table,
+      bound_variables,
+      substitution
+    );
+  }
+
+  auto Primitive::replace(
+    Variable& variable,
+    Expression& expression,
+    std::multiset<std::string>& bound_variables
+  ) -> std::pair<Expression*, ReduceType> {
+    [[unlikely]] if (definition->is_variable_free(variable.get_literal())) {
+      return unfold()->replace(variable, expression, bound_variables);
     }
-    string_println("time cost:        " + std::to_string(msec) + "ms", out);
-    fprintf(out, "\n");
 
-    return expr;
+    auto reduce_type = ReduceType::Null;
+    for (auto& argument: arguments) {
+      auto [new_argument, argument_reduce_type] = argument->replace(
+        variable,
+        expression,
+        bound_variables
+      );
+      argument = new_argument;
+      if (!(bool)reduce_type) { reduce_type = argument_reduce_type; }
+    }
+
+    if ((bool)reduce_type) {
+      is_normal_form = false;
+      is_is_eager_flag_updated = false;
+      is_hash_updated = false;
+    }
+
+    return { this, reduce_type };
   }
 
+  auto Primitive::apply(
+    Expression& expression,
+    std::multiset<std::string>& bound_variables
+  ) -> std::pair<Expression*, ReduceType> {
+    arguments.push_back(expression.clone());
+    is_is_eager_flag_updated = false;
+    is_hash_updated = false;
+    // stands for the beta reduction substituting it, see `instantiate`
+    if (arguments.size() < native_operator->arity) {
+      return { this, ReduceType::Beta };
+    }
 
-  void Reducer::register_symbol(
-    std::string literal,
-    Expression* expression
-  ) {
-    symbol_table[literal] = expression;
+    std::vector<unsigned> values;
+    for (auto argument: arguments) {
+      unsigned value;
+      if (!get_numeral(argument, bound_variables, value)) {
+        return { instantiate(bound_variables), ReduceType::Beta };
+      }
+      values.push_back(value);
+    }
+
+    auto result = native_operator->evaluate(values);
+    [[unlikely]] if (result == nullptr) {
+      return { instantiate(bound_variables), ReduceType::Beta };
+    }
+
+    delete_instance();
+    return { result, ReduceType::Delta };
   }
 
-  Reducer::~Reducer() {
+  auto Primitive::to_string() -> std::string {
+    [[likely]] if (arguments.empty()) { return definition->to_string(); }
+
+    auto result = "(" + definition->to_string() + ")";
+    for (auto argument: arguments) {
+      if (argument->get_priority() <= Priority::Application) {
+        result += " (" + argument->to_string() + ")";
+      }
+      else { result += " " + argument->to_string(); }
+    }
+    return result;
+  }
+
+  auto Primitive::get_priority() -> Priority {
+    return arguments.empty() ? Priority::Abstraction : Priority::Application;
+  }
+
+  auto Primitive::clone() -> Expression* {
+    return this->clone(computational_priority_flag);
+  }
+  auto Primitive::clone(
+    ComputationalPriority new_computational_priority
+  ) -> Expression* {
+    auto result = new Primitive(
+      native_operator,
+      definition,
+      computational_priority_flag
+    );
+    for (auto argument: arguments) {
+      result->arguments.push_back(argument->clone());
+    }
+
+    result->is_normal_form = is_normal_form;
+
+    result->is_is_eager_flag_updated = is_is_eager_flag_updated;
+    result->is_eager_flag = is_eager_flag;
+    result->copy_hash(*this);
+
+    result->set_computational_priority(new_computational_priority);
+
+    return result;
+  }
+
+  bool Primitive::is_variable_free(const std::string& literal) {
+    if (definition->is_variable_free(literal)) { return true; }
+    for (auto argument: arguments) {
+      if (argument->is_variable_free(literal)) { return true; }
+    }
+    return false;
+  }
+
+  void Primitive::update_eager_flag(
+    std::multiset<std::string>& bound_variables
+  ) {
+    if (is_is_eager_flag_updated) { return; }
+    is_is_eager_flag_updated = true;
+
+    is_eager_flag = !is_normal_form && !is_lazy();
+    if (!is_eager_flag) { return; }
+
+    is_eager_flag = is_marked_eager(
+      this, computational_priority_flag, bound_variables
+    );
+    for (auto argument: arguments) {
+      if (is_eager_flag) { break; }
+      is_eager_flag = argument->is_eager(bound_variables);
+    }
+  }
+  void Primitive::update_hash() {
+    if (is_hash_updated) { return; }
+    is_hash_updated = true;
+
+    hash_value = combine_hash(
+      (size_t)HashTag::Primitive,
+      std::hash<const void*>()(native_operator)
+    );
+    size_value = 1;
+    for (auto argument: arguments) {
+      hash_value = combine_hash(hash_value, argument->get_hash());
+      size_value += argument->get_size();
+    }
+  }
+
+
+  auto Primitive::get_native_operator() -> const NativeOperator* {
+    return native_operator;
+  }
+
+  auto Primitive::get_missing_count() -> size_t {
+    return native_operator->arity - arguments.size();
+  }
+
+  void Primitive::collect(Expression* argument) {
+    arguments.push_back(argument);
+    is_is_eager_flag_updated = false;
+    is_hash_updated = false;
+  }
+
+  auto Primitive::expand() -> Expression* {
+    return static_cast<Primitive*>(clone())->unfold();
+  }
+
+  auto Primitive::unfold() -> Expression* {
+    Expression* result = definition->clone(
+      arguments.empty()
+        ? computational_priority_flag
+        : ComputationalPriority::Neutral
+    );
+    for (auto argument: arguments) {
+      result = new Application(result, argument);
+    }
+    result->set_computational_priority(computational_priority_flag);
+
+    delete this;
+    return result;
+  }
+
+  auto Primitive::instantiate(
+    std::multiset<std::string>& bound_variables
+  ) -> Expression* {
+    Expression* result = definition->clone(ComputationalPriority::Neutral);
+    for (auto argument: arguments) {
+      result = result->apply(*argument, bound_variables).first;
+      argument->delete_instance();
+    }
+    arguments.clear();
+    result->set_computational_priority(computational_priority_flag);
+
+    delete this;
+    return result;
+  }
+
+  bool Primitive::get_numeral(
+    Expression* argument,
+    std::multiset<std::string>& bound_variables,
+    unsigned& value
+  ) {
+    if (auto numeral = dynamic_cast<Numeral*>(argument)) {
+      value = numeral->get_value();
+      return true;
+    }
+
+    // a literal, which is not unfolded yet
+    auto variable = dynamic_cast<Variable*>(argument);
+    if (
+      variable == nullptr
+      || !is_number(variable->get_literal())
+      || has(bound_variables, variable->get_literal())
+    ) {
+      return false;
+    }
+    value = to_number(variable->get_literal());
+    return true;
+  }
+
+
+  static auto generate_church_number_body(unsigned number) -> Expression* {
+    [[unlikely]] if (number == 0) { return new Variable("x"); }
+
+    return new Application(
+      new Variable("f"),
+      generate_church_number_body(number - 1)
+    );
+  }
+
+  Closure::Closure(
+    Expression* body,
+    Variable binder,
+    Expression* argument,
+    ExplicitSubstitution& substitution,
+    ComputationalPriority computational_priority
+  ): Expression(computational_priority),
+    body(body),
+    binder(binder),
+    argument(new Argument { argument, substitution, false, {} }) {
+    substitution.closure_count++;
+  }
+
+  Closure::Closure(
+    Expression* body,
+    Variable binder,
+    std::shared_ptr<Argument> argument,
+    ComputationalPriority computational_priority
+  ): Expression(computational_priority),
+    body(body),
+    binder(binder),
+    argument(argument) {
+    argument->substitution.closure_count++;
+  }
+
+  Closure::~Closure() {
+    argument->substitution.closure_count--;
+  }
+
+  Closure::Argument::~Argument() {
+    expression->delete_instance();
+  }
+
+  bool Closure::Argument::is_variable_free(const std::string& literal) {
+    auto [it, inserted] = free_literals.emplace(literal, false);
+    if (inserted) { it->second = expression->is_variable_free(literal); }
+    return it->second;
+  }
+
+  void Closure::delete_instance() {
+    body->delete_instance();
+    delete this;
+  }
+
+  auto Closure::reduce(
+    std::map<std::string, Expression*>& symbol_table,
+    std::multiset<std::string>& bound_variables,
+    ExplicitSubstitution* substitution
+  ) -> std::pair<Expression*, ReduceType> {
+    return push(bound_variables)->reduce(
+      symbol_table,
+      bound_variables,
+      substitution
+    );
+  }
+
+  auto Closure::replace(
+    Variable& variable,
+    Expression& expression,
+    std::multiset<std::string>& bound_variables
+  ) -> std::pair<Expression*, ReduceType> {
+    auto new_expr = push(bound_variables)->replace(
+      variable,
+      expression,
+      bound_variables
+    ).first;
+    // the node has changed even when `variable` does not occur
+    return { new_expr, ReduceType::Beta };
+  }
+
+  auto Closure::apply(
+    Expression& expression,
+    std::multiset<std::string>& bound_variables
+  ) -> std::pair<Expression*, ReduceType> {
+    // applications push closures out of function position before applying
+    return { this, ReduceType::Null };
+  }
+
+  auto Closure::to_string() -> std::string {
+    return to_string_in(nullptr).first;
+  }
+
+  auto Closure::get_priority() -> Priority {
+    auto variable = dynamic_cast<Variable*>(body);
+    [[unlikely]] if (variable != nullptr && *variable == binder) {
+      return argument->expression->get_priority();
+    }
+    return body->get_priority();
+  }
+
+  auto Closure::clone() -> Expression* {
+    return this->clone(computational_priority_flag);
+  }
+  auto Closure::clone(
+    ComputationalPriority new_computational_priority
+  ) -> Expression* {
+    auto result = new Closure(
+      body->clone(),
+      binder,
+      argument,
+      computational_priority_flag
+    );
+
+    result->is_normal_form = is_normal_form;
+
+    result->is_is_eager_flag_updated = is_is_eager_flag_updated;
+    result->is_eager_flag = is_eager_flag;
+    result->copy_hash(*this);
+
+    result->set_computational_priority(new_computational_priority);
+
+    return result;
+  }
+
+  // binders and pending substitutions around a node, innermost first.
+  // `argument` is nullptr for binders
+  struct Closure::Scope {
+    const std::string& literal;
+    Expression* argument;
+    const Scope* outer;
+  };
+
+  // whether `literal` is free in `expression` once the substitutions of
+  // `scope` are carried out. the `inner_count` innermost entries of `scope`
+  // are within the term asked about, the binders beyond are outside and
+  // leave their variables free. a single walk, asking the body of a closure
+  // for both its own variable and `literal` would take exponential time in
+  // the depth of nested closures
+  static bool is_free_in_scope(
+    Expression* expression,
+    const std::string& literal,
+    const Closure::Scope* scope,
+    size_t inner_count
+  ) {
+    if (auto variable = dynamic_cast<Variable*>(expression)) {
+      for (; scope != nullptr; scope = scope->outer) {
+        if (scope->literal != variable->get_literal()) {
+          if (inner_count > 0) { inner_count--; }
+          continue;
+        }
+        if (scope->argument == nullptr) {
+          return inner_count == 0 && scope->literal == literal;
+        }
+        return is_free_in_scope(
+          scope->argument,
+          literal,
+          scope->outer,
+          inner_count > 0 ? inner_count - 1 : 0
+        );
+      }
+      return variable->get_literal() == literal;
+    }
+    if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      Closure::Scope inner {
+        abstraction->get_binder().get_literal(),
+        nullptr,
+        scope
+      };
+      return is_free_in_scope(
+        abstraction->get_body(), literal, &inner, inner_count + 1
+      );
+    }
+    if (auto application = dynamic_cast<Application*>(expression)) {
+      return is_free_in_scope(
+          application->get_first(), literal, scope, inner_count
+        )
+        || is_free_in_scope(
+          application->get_second(), literal, scope, inner_count
+        );
+    }
+    if (auto closure = dynamic_cast<Closure*>(expression)) {
+      return closure->is_variable_free_in(literal, scope, inner_count);
+    }
+    // numerals are the most frequent leaves and have nothing free
+    if (typeid(*expression) == typeid(Numeral)) { return false; }
+
+    // anything else is asked for each variable the scope may bind
+    std::set<std::string> shadowed;
+    for (; scope != nullptr; scope = scope->outer) {
+      auto is_inner = inner_count > 0;
+      if (is_inner) { inner_count--; }
+      if (!shadowed.insert(scope->literal).second) { continue; }
+      if (!expression->is_variable_free(scope->literal)) { continue; }
+
+      if (scope->argument == nullptr) {
+        if (!is_inner && scope->literal == literal) { return true; }
+      }
+      else if (
+        is_free_in_scope(scope->argument, literal, scope->outer, inner_count)
+      ) {
+        return true;
+      }
+    }
+    return !has(shadowed, literal) && expression->is_variable_free(literal);
+  }
+
+  bool Closure::is_variable_free_in(
+    const std::string& literal,
+    const Scope* scope,
+    size_t inner_count
+  ) {
+    Scope inner { binder.get_literal(), argument->expression, scope };
+    return is_free_in_scope(body, literal, &inner, inner_count + 1);
+  }
+
+  bool Closure::is_variable_free(const std::string& literal) {
+    return is_variable_free_in(literal, nullptr, 0);
+  }
+
+  // whether a substitution of `scope` brings a free `literal` in, which a
+  // binder of that name would capture
+  static bool is_captured(const std::string& literal, const Closure::Scope* scope) {
+    std::set<std::string> shadowed;
+    for (; scope != nullptr; scope = scope->outer) {
+      if (!shadowed.insert(scope->literal).second) { continue; }
+      if (
+        scope->argument != nullptr
+        && is_free_in_scope(scope->argument, literal, scope->outer, 0)
+      ) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // `expression` with the substitutions of `scope` carried out, printed as
+  // `substitute()` would print it up to the names of renamed binders. nothing
+  // is copied but the native operators some substitution reaches
+  static auto to_string_in_scope(
+    Expression* expression,
+    const Closure::Scope* scope
+  ) -> std::pair<std::string, Priority> {
+    if (auto variable = dynamic_cast<Variable*>(expression)) {
+      for (auto outer = scope; outer != nullptr; outer = outer->outer) {
+        if (outer->literal != variable->get_literal()) { continue; }
+        if (outer->argument == nullptr) { break; }
+        return to_string_in_scope(outer->argument, outer->outer);
+      }
+      return { variable->get_literal(), Priority::Variable };
+    }
+    if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      auto& binder = abstraction->get_binder().get_literal();
+      auto body = abstraction->get_body();
+
+      // renamed as Abstraction::replace would, to a literal no substitution
+      // of `scope` binds
+      std::string new_literal;
+      [[unlikely]] if (is_captured(binder, scope)) {
+        for (int i = 0;; i++) {
+          new_literal = index_to_string(i);
+          auto outer = scope;
+          while (outer != nullptr && outer->literal != new_literal) {
+            outer = outer->outer;
+          }
+          [[likely]] if (
+            outer == nullptr
+            && new_literal != binder
+            && !is_free_in_scope(body, new_literal, scope, 0)
+          ) {
+            break;
+          }
+        }
+      }
+      Variable renamed(new_literal);
+      Closure::Scope inner {
+        binder,
+        new_literal.empty() ? nullptr : &renamed,
+        scope
+      };
+
+      auto [string, priority] = to_string_in_scope(body, &inner);
+      return {
+        "\\" + (new_literal.empty() ? binder : new_literal)
+          + "." + (priority > Priority::Abstraction ? " " : "") + string,
+        Priority::Abstraction
+      };
+    }
+    if (auto application = dynamic_cast<Application*>(expression)) {
+      auto [first, first_priority] = to_string_in_scope(
+        application->get_first(), scope
+      );
+      auto [second, second_priority] = to_string_in_scope(
+        application->get_second(), scope
+      );
+      if (first_priority < Priority::Application) { first = "(" + first + ")"; }
+      if (second_priority <= Priority::Application) { second = "(" + second + ")"; }
+      return { first + " " + second, Priority::Application };
+    }
+    if (auto closure = dynamic_cast<Closure*>(expression)) {
+      return closure->to_string_in(scope);
+    }
+
+    // substituted one variable after the other, outermost last
+    std::set<std::string> shadowed;
+    Expression* substituted = nullptr;
+    for (; scope != nullptr; scope = scope->outer) {
+      if (!shadowed.insert(scope->literal).second) { continue; }
+      if (scope->argument == nullptr) { continue; }
+
+      auto current = substituted ? substituted : expression;
+      if (!current->is_variable_free(scope->literal)) { continue; }
+      if (!substituted) { substituted = expression->clone(); }
+
+      std::multiset<std::string> bound_variables;
+      Variable variable(scope->literal);
+      substituted = substituted->replace(
+        variable,
+        *scope->argument,
+        bound_variables
+      ).first;
+    }
+    if (!substituted) {
+      return { expression->to_string(), expression->get_priority() };
+    }
+    std::pair<std::string, Priority> result {
+      substituted->to_string(), substituted->get_priority()
+    };
+    substituted->delete_instance();
+    return result;
+  }
+
+  auto Closure::to_string_in(
+    const Scope* scope
+  ) -> std::pair<std::string, Priority> {
+    Scope inner { binder.get_literal(), argument->expression, scope };
+    return to_string_in_scope(body, &inner);
+  }
+
+  // whether `expression` is eager once the substitutions of `scope` are
+  // carried out and `priority` is given to it, as update_eager_flag() would
+  // find. the abstractions and applications a substitution is pushed into
+  // are no normal forms anymore. HeadEager is left to the terms pushed out,
+  // whose heads are only known then
+  static bool is_eager_in_scope(
+    Expression* expression,
+    ComputationalPriority priority,
+    std::multiset<std::string>& bound_variables,
+    const Closure::Scope* scope
+  ) {
+    if (auto variable = dynamic_cast<Variable*>(expression)) {
+      for (auto outer = scope; outer != nullptr; outer = outer->outer) {
+        if (outer->literal != variable->get_literal()) { continue; }
+        return is_eager_in_scope(
+          outer->argument, priority, bound_variables, outer->outer
+        );
+      }
+      return !variable->is_in_normal_form()
+        && priority == ComputationalPriority::Eager
+        && !has(bound_variables, variable->get_literal())
+        && !is_number(variable->get_literal());
+    }
+    if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      auto is_normal_form = abstraction->is_in_normal_form();
+      for (auto outer = scope; outer != nullptr; outer = outer->outer) {
+        if (outer->literal != abstraction->get_binder().get_literal()) {
+          is_normal_form = false;
+        }
+      }
+      return !is_normal_form && priority == ComputationalPriority::Eager;
+    }
+    if (auto application = dynamic_cast<Application*>(expression)) {
+      auto& first = application->get_first();
+      auto& second = application->get_second();
+      return (scope != nullptr || !application->is_in_normal_form())
+        && priority != ComputationalPriority::Lazy
+        && (
+          priority == ComputationalPriority::Eager
+          || is_eager_in_scope(
+            first, first->get_computational_priority(), bound_variables, scope
+          )
+          || is_eager_in_scope(
+            second, second->get_computational_priority(), bound_variables, scope
+          )
+        );
+    }
+    if (auto closure = dynamic_cast<Closure*>(expression)) {
+      return closure->is_eager_in(priority, bound_variables, scope);
+    }
+
+    // numerals, and native operators as if nothing reached their arguments
+    auto own_priority = expression->get_computational_priority();
+    expression->set_computational_priority(priority);
+    auto result = expression->is_eager(bound_variables);
+    expression->set_computational_priority(own_priority);
+    return result;
+  }
+
+  bool Closure::is_eager_in(
+    ComputationalPriority priority,
+    std::multiset<std::string>& bound_variables,
+    const Scope* scope
+  ) {
+    Scope inner { binder.get_literal(), argument->expression, scope };
+    return is_eager_in_scope(body, priority, bound_variables, &inner);
+  }
+
+  void Closure::update_eager_flag(
+    std::multiset<std::string>& bound_variables
+  ) {
+    if (is_is_eager_flag_updated) { return; }
+    is_is_eager_flag_updated = true;
+
+    is_eager_flag = is_eager_in(
+      computational_priority_flag, bound_variables, nullptr
+    );
+  }
+  void Closure::update_hash() {
+    if (is_hash_updated) { return; }
+    is_hash_updated = true;
+
+    hash_value = combine_hash(
+      combine_hash(
+        combine_hash(
+          (size_t)HashTag::Closure,
+          std::hash<std::string>()(binder.get_literal())
+        ),
+        body->get_hash()
+      ),
+      argument->expression->get_hash()
+    );
+    size_value = 1 + body->get_size() + argument->expression->get_size();
+  }
+
+  // push the closures anywhere in `expression` out, but the ones in native
+  // operators. whether any was
+  static bool push_all_closures(
+    Expression*& expression,
+    std::multiset<std::string>& bound_variables
+  ) {
+    bool is_pushed = false;
+    while (typeid(*expression) == typeid(Closure)) {
+      expression = static_cast<Closure*>(expression)->push(bound_variables);
+      is_pushed = true;
+    }
+    // the reduction pushes every closure out of what it marks normal
+    if (expression->is_in_normal_form()) { return is_pushed; }
+
+    if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      auto it = bound_variables.emplace(abstraction->get_binder().get_literal());
+      if (push_all_closures(abstraction->get_body(), bound_variables)) {
+        abstraction->invalidate_hash();
+        is_pushed = true;
+      }
+      bound_variables.erase(it);
+    }
+    else if (auto application = dynamic_cast<Application*>(expression)) {
+      auto first = push_all_closures(application->get_first(), bound_variables);
+      auto second = push_all_closures(application->get_second(), bound_variables);
+      if (first || second) {
+        application->invalidate_hash();
+        is_pushed = true;
+      }
+    }
+    return is_pushed;
+  }
+
+  auto Closure::push(
+    std::multiset<std::string>& bound_variables
+  ) -> Expression* {
+    argument->substitution.substitution_count++;
+    Expression* result = body;
+    // the child this closure moves down to, saving an allocation
+    Expression** moved_to = nullptr;
+
+    if (auto variable = dynamic_cast<Variable*>(body)) {
+      if (*variable == binder) {
+        // pushed out once instead of in every copy
+        [[unlikely]] if (!argument->is_pushed) {
+          std::multiset<std::string> argument_bound_variables;
+          push_all_closures(argument->expression, argument_bound_variables);
+          argument->is_pushed = true;
+        }
+        result = argument->expression->clone(
+          variable->get_computational_priority()
+        );
+        variable->delete_instance();
+      }
+    }
+    else if (auto abstraction = dynamic_cast<Abstraction*>(body)) {
+      auto& inner_binder = abstraction->get_binder();
+      auto& inner_body = abstraction->get_body();
+
+      [[likely]] if (!(inner_binder == binder)) {
+        // the binder is renamed by a closure of its own
+        [[unlikely]] if (argument->is_variable_free(inner_binder.get_literal())) {
+          for (int i = 0;; i++) {
+            std::string&& new_literal = index_to_string(i);
+            [[likely]] if (
+              !has(bound_variables, new_literal)
+              && new_literal != inner_binder.get_literal()
+              && new_literal != binder.get_literal()
+              && !argument->is_variable_free(new_literal)
+              && !inner_body->is_variable_free(new_literal)
+            ) {
+              inner_body = new Closure(
+                inner_body,
+                inner_binder,
+                new Variable(new_literal),
+                argument->substitution,
+                inner_body->get_computational_priority()
+              );
+              inner_binder = Variable(new_literal);
+              break;
+            }
+          }
+        }
+
+        moved_to = &inner_body;
+        abstraction->is_normal_form = false;
+        abstraction->is_is_eager_flag_updated = false;
+        abstraction->is_hash_updated = false;
+      }
+    }
+    else if (auto application = dynamic_cast<Application*>(body)) {
+      auto& first = application->get_first();
+      first = new Closure(first, binder, argument, first->get_computational_priority());
+      moved_to = &application->get_second();
+      application->is_normal_form = false;
+      application->is_is_eager_flag_updated = false;
+      application->is_hash_updated = false;
+    }
+    else if (auto closure = dynamic_cast<Closure*>(body)) {
+      body = closure->push(bound_variables);
+      return push(bound_variables);
+    }
+    else if (dynamic_cast<Primitive*>(body) != nullptr) {
+      result = body->replace(binder, *argument->expression, bound_variables).first;
+    }
+
+    result->set_computational_priority(computational_priority_flag);
+
+    if (moved_to == nullptr) {
+      delete this;
+      return result;
+    }
+
+    body = *moved_to;
+    computational_priority_flag = body->get_computational_priority();
+    is_is_eager_flag_updated = false;
+    is_hash_updated = false;
+    *moved_to = this;
+    return result;
+  }
+
+  auto Closure::substitute() -> Expression* {
+    std::multiset<std::string> bound_variables;
+    auto result = body->clone()->replace(
+      binder,
+      *argument->expression,
+      bound_variables
+    ).first;
+    result->set_computational_priority(computational_priority_flag);
+    return result;
+  }
+
+
+  auto generate_church_number(unsigned number) -> Expression* {
+    return new Abstraction(
+      Variable("f"),
+      new Abstraction(
+        Variable("x"),
+        generate_church_number_body(number)
+      )
+    );
+  }
+
+  static std::string reduce_type_to_header(ReduceType reduce_type) {
+    switch (reduce_type) {
+      [[unlikely]] case ReduceType::Alpha: return "alpha> ";
+      [[likely]] case ReduceType::Beta: return "beta>  ";
+      case ReduceType::Delta: return "delta> ";
+      default: assert(false); return "";
+    }
+  }
+
+  static void string_println(std::string& s, FILE* out) {
+    fprintf(out, "%s\n", s.c_str());
+  }
+
+  static void string_println(std::string&& s, FILE* out) {
+    fprintf(out, "%s\n", s.c_str());
+  }
+
+  clock_t msec_count(std::function<void(void)> func) {
+    auto start_time = clock();
+    func();
+    auto end_time = clock();
+    return (end_time - start_time) / (double)CLOCKS_PER_SEC * 1000;
+  }
+
+  // steps between two updates of the streamed result
+  static constexpr unsigned long long STREAM_INTERVAL = 256;
+
+  auto Reducer::reduce(
+     Expression* expression, FILE* out, const ReduceOptions& options
+  ) -> Expression* {
+    return reduce_from(expression, expression->clone(), 0, 0, out, options);
+  }
+
+  auto Reducer::resume(
+    const std::string& path, FILE* out, const ReduceOptions& options
+  ) -> Expression* {
+    Checkpoint checkpoint;
+    read_checkpoint(path, checkpoint);
+
+    for (auto& [literal, definition]: checkpoint.symbols) {
+      auto it = symbol_table.find(literal);
+      if (it != symbol_table.end()) { it->second->delete_instance(); }
+      register_symbol(literal, definition);
+    }
+    checkpoint.symbols.clear();
+
+    auto expr = checkpoint.expression;
+    checkpoint.expression = nullptr;
+    return reduce_from(
+      checkpoint.query, expr, checkpoint.step, checkpoint.msec, out, options
+    );
+  }
+
+  auto Reducer::reduce_from(
+    Expression* expression,
+    Expression* expr,
+    unsigned long long first_step,
+    clock_t previous_msec,
+    FILE* out,
+    const ReduceOptions& options
+  ) -> Expression* {
+
+    string_println(expression->to_string(), out);
+    fprintf(out, "\n");
+
+    unsigned long long step;
+    unsigned long long character_count = 0;
+
+    auto backend = make_backend(options.engine);
+
+    // an engine may give up on a term, as the net does on a vicious circle,
+    // which the tree rewriter then reduces from the start
+    std::string fallback;
+    auto start_msec = previous_msec;
+    if (backend) {
+      start_msec += msec_count([&]() {
+        try {
+          auto result = backend->normalize(expr, symbol_table, step);
+          step += first_step;
+          expr->delete_instance();
+          expr = result;
+        }
+        catch (std::runtime_error& error) {
+          fallback = error.what();
+        }
+      });
+      if (!fallback.empty()) { backend = nullptr; }
+    }
+
+    // the printed intermediate terms and the decoded result would interleave
+    // with the streamed result
+    std::unique_ptr<StreamPrinter> stream;
+    if (
+      options.stream_result
+      && !options.display_process
+      && !options.decode_result
+      && !options.print_dag
+      && options.strategy == StrategyType::Annotated
+      && !backend
+    ) {
+      stream = std::make_unique<StreamPrinter>(out);
+      fprintf(out, "\n");
+      string_println("to be sought:     " + expression->to_string(), out);
+      fprintf(out, "result:           ");
+    }
+
+    // beta reductions then make closures instead of substituting
+    auto is_explicit = options.explicit_substitution
+      && options.strategy == StrategyType::Annotated
+      && !backend;
+    substitution.substitution_count = 0;
+    auto strategy = make_strategy(
+      options.strategy, is_explicit ? &substitution : nullptr
+    );
+
+    std::unique_ptr<DivergenceDetector> divergence;
+    if (options.detect_divergence && !backend) {
+      divergence = std::make_unique<DivergenceDetector>();
+    }
+    std::string diagnostic;
+
+    // the net is not saved
+    std::unique_ptr<CheckpointWriter> checkpoint;
+    if (!options.checkpoint_path.empty() && !backend) {
+      checkpoint = std::make_unique<CheckpointWriter>(
+        options.checkpoint_path,
+        options.checkpoint_steps,
+        options.checkpoint_seconds
+      );
+    }
+    // SIGUSR1 is answered even when no progress line is asked for
+    std::unique_ptr<ProgressReporter> progress;
+    if (!backend) {
+      progress = std::make_unique<ProgressReporter>(
+        options.progress_seconds, first_step
+      );
+    }
+    auto start_time = clock();
+
+    auto msec = start_msec;
+    if (!backend) {
+      msec += msec_count([&]() {
+        for (step = first_step;; step++) {
+          auto reduce_type = strategy->step(expr, symbol_table);
+
+          [[unlikely]] if (reduce_type == ReduceType::Null) { break; }
+
+          [[unlikely]] if (stream && step % STREAM_INTERVAL == 0) {
+            stream->update(expr);
+          }
+
+          if (options.display_process) {
+            auto&& str = reduce_type_to_header(reduce_type) + expr->to_string();
+            character_count += str.length();
+            string_println(str, out);
+          }
+
+          [[unlikely]] if (divergence) {
+            diagnostic = divergence->check(expr, step + 1);
+            if (!diagnostic.empty()) {
+              step++;
+              break;
+            }
+          }
+
+          [[unlikely]] if (checkpoint && checkpoint->is_due(step + 1)) {
+            auto msec = start_msec
+              + (clock_t)((clock() - start_time) / (double)CLOCKS_PER_SEC * 1000);
+            checkpoint->save(expression, expr, step + 1, msec, symbol_table);
+          }
+
+          [[unlikely]] if (progress->is_due(step + 1)) {
+            progress->report(expr, step + 1);
+          }
+        }
+      });
+    }
+
+    if (stream) {
+      if (diagnostic.empty()) { stream->finish(expr); }
+      fprintf(out, "\n");
+    }
+    else {
+      fprintf(out, "\n");
+      string_println("to be sought:     " + expression->to_string(), out);
+    }
+    if (!diagnostic.empty()) {
+      string_println("diverged:         " + diagnostic, out);
+    }
+    else if (options.print_dag && !options.decode_result) {
+      // lines that can be imported again, aligned with the other fields
+      auto dag = to_dag_form(expr);
+      if (dag.definitions.empty()) {
+        string_println("result:           " + dag.expression, out);
+      }
+      else {
+        auto header = std::string("result:           ");
+        for (auto& definition: dag.definitions) {
+          string_println(header + definition, out);
+          header = std::string(header.length(), ' ');
+        }
+        string_println(header + "@ " + dag.expression, out);
+      }
+    }
+    else if (!stream) {
+      string_println(
+        "result:           "
+          + (options.decode_result ? to_decoded_string(expr) : expr->to_string()),
+        out
+      );
+    }
+    if (options.strategy != StrategyType::Annotated) {
+      string_println("strategy:         " + strategy_name(options.strategy), out);
+    }
+    if (backend) {
+      string_println(
+        "engine:           " + engine_name(options.engine)
+          + " (" + backend->get_statistics() + ")",
+        out
+      );
+    }
+    else if (!fallback.empty()) {
+      string_println(
+        "engine:           tree, " + engine_name(options.engine)
+          + " gave up: " + fallback,
+        out
+      );
+    }
+    string_println("step taken:       " + std::to_string(step), out);
+    if (is_explicit) {
+      string_println(
+        "substitutions:    " + std::to_string(substitution.substitution_count),
+        out
+      );
+    }
+    if (options.display_process) {
+      string_println("character count:  " + std::to_string(character_count), out);
+    }
+    string_println("time cost:        " + std::to_string(msec) + "ms", out);
+    fprintf(out, "\n");
+
+    return expr;
+  }
+
+
+  void Reducer::register_symbol(
+    std::string literal,
+    Expression* expression
+  ) {
+    if (native_arithmetic) {
+      if (
+        auto native_operator = find_native_operator(literal, expression, symbol_table)
+      ) {
+        expression = new Primitive(
+          native_operator,
+          std::shared_ptr<Expression>(expression, [](Expression* definition) {
+            definition->delete_instance();
+          })
+        );
+      }
+    }
+
+    // a later definition wins, as when nothing is deferred
+    auto it = deferred_symbols.find(literal);
+    if (it != deferred_symbols.end()) {
+      if (it->second.expression) { it->second.expression->delete_instance(); }
+      deferred_symbols.erase(it);
+    }
+
+    auto is_redefined = symbol_table.count(literal) > 0;
+    symbol_table[literal] = expression;
+    if (native_arithmetic && is_redefined) { check_native_operators(); }
+  }
+
+  void Reducer::check_native_operators() {
+    for (auto is_changed = true; is_changed;) {
+      is_changed = false;
+      for (auto& [literal, definition]: symbol_table) {
+        auto primitive = dynamic_cast<Primitive*>(definition);
+        if (primitive == nullptr) { continue; }
+
+        auto expanded = primitive->expand();
+        if (find_native_operator(literal, expanded, symbol_table)) {
+          expanded->delete_instance();
+          continue;
+        }
+        primitive->delete_instance();
+        definition = expanded;
+        is_changed = true;
+      }
+    }
+  }
+
+  void Reducer::defer_symbol(
+    const std::string& literal,
+    Expression* expression,
+    std::function<Expression*()> load,
+    std::function<void(Expression*)> define
+  ) {
+    auto it = deferred_symbols.find(literal);
+    if (it != deferred_symbols.end() && it->second.expression) {
+      it->second.expression->delete_instance();
+    }
+    deferred_symbols[literal] = { expression, std::move(load), std::move(define) };
+  }
+
+  // literals free in `expression` that are not in `literals` yet, in order
+  // of appearance. queries and definitions are made of variables,
+  // abstractions, applications and numerals only
+  static void collect_free_literals(
+    Expression* expression,
+    std::multiset<std::string>& bound_variables,
+    std::vector<std::string>& literals
+  ) {
+    if (auto root = dynamic_cast<Root*>(expression)) {
+      collect_free_literals(root->get_expression(), bound_variables, literals);
+    }
+    else if (auto variable = dynamic_cast<Variable*>(expression)) {
+      auto& literal = variable->get_literal();
+      if (
+        !has(bound_variables, literal)
+        && std::find(literals.begin(), literals.end(), literal) == literals.end()
+      ) {
+        literals.push_back(literal);
+      }
+    }
+    else if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      auto it = bound_variables.emplace(abstraction->get_binder().get_literal());
+      collect_free_literals(abstraction->get_body(), bound_variables, literals);
+      bound_variables.erase(it);
+    }
+    else if (auto application = dynamic_cast<Application*>(expression)) {
+      collect_free_literals(application->get_first(), bound_variables, literals);
+      collect_free_literals(application->get_second(), bound_variables, literals);
+    }
+  }
+
+  void Reducer::materialize(Expression* expression) {
+    if (deferred_symbols.empty()) { return; }
+
+    std::multiset<std::string> bound_variables;
+    std::vector<std::string> literals;
+    collect_free_literals(expression, bound_variables, literals);
+
+    for (auto& literal: literals) {
+      auto it = deferred_symbols.find(literal);
+      if (it == deferred_symbols.end()) { continue; }
+
+      // taken out first, so that recursive definitions stop here
+      auto symbol = std::move(it->second);
+      deferred_symbols.erase(it);
+
+      auto definition = symbol.expression ? symbol.expression : symbol.load();
+      materialize(definition);
+      if (symbol.define) {
+        symbol.define(definition);
+      }
+      else {
+        register_symbol(literal, definition);
+      }
+    }
+  }
+
+  auto Reducer::find_symbol(const std::string& literal) -> Expression* {
+    auto it = symbol_table.find(literal);
+    return it == symbol_table.end() ? nullptr : it->second;
+  }
+
+  void Reducer::use_native_arithmetic() {
+    native_arithmetic = true;
+  }
+
+  static bool is_eager_argument(Expression* expression) {
+    auto priority = expression->get_computational_priority();
+    return priority == ComputationalPriority::Eager
+      || priority == ComputationalPriority::HeadEager;
+  }
+
+  // contract the leftmost outermost redex that is safe to contract ahead of
+  // time: beta redexes whose argument is not eager, since `{}` arguments are
+  // there to be evaluated once before being substituted, and unfolding of
+  // non-recursive symbols registered before `literal` in function position
+  static bool prenormalize_step(
+    Expression*& expression,
+    const std::string& literal,
+    std::map<std::string, Expression*>& symbol_table,
+    std::multiset<std::string>& bound_variables
+  ) {
+    if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      auto it = bound_variables.emplace(abstraction->get_binder().get_literal());
+      auto reduced = prenormalize_step(
+        abstraction->get_body(), literal, symbol_table, bound_variables
+      );
+      bound_variables.erase(it);
+      return reduced;
+    }
+
+    auto application = dynamic_cast<Application*>(expression);
+    if (application == nullptr) { return false; }
+
+    auto& first = application->get_first();
+    auto& second = application->get_second();
+
+    if (!is_eager_argument(second)) {
+      auto variable = dynamic_cast<Variable*>(first);
+      if (
+        variable != nullptr
+        && variable->get_literal() != literal
+        && !has(bound_variables, variable->get_literal())
+      ) {
+        auto symbol = symbol_table.find(variable->get_literal());
+        // recursive symbols would unfold forever
+        if (
+          symbol != symbol_table.end()
+          && dynamic_cast<Abstraction*>(symbol->second) != nullptr
+          && !symbol->second->is_variable_free(symbol->first)
+        ) {
+          auto new_expr = symbol->second->clone(
+            variable->get_computational_priority()
+          );
+          variable->delete_instance();
+          first = new_expr;
+          return true;
+        }
+      }
+
+      auto [new_expr, reduce_type] = application->contract(bound_variables);
+      if ((bool)reduce_type) {
+        expression = new_expr;
+        return true;
+      }
+    }
+
+    return prenormalize_step(first, literal, symbol_table, bound_variables)
+      || prenormalize_step(second, literal, symbol_table, bound_variables);
+  }
+
+  auto Reducer::prenormalize(
+    const std::string& literal,
+    Expression*& expression,
+    unsigned long long budget
+  ) -> unsigned long long {
+    unsigned long long step = 0;
+    std::multiset<std::string> bound_variables;
+    for (; step < budget; step++) {
+      if (!prenormalize_step(expression, literal, symbol_table, bound_variables)) {
+        break;
+      }
+    }
+    return step;
+  }
+
+  Reducer::~Reducer() {
     for (auto symbol: symbol_table) {
       symbol.second->delete_instance();
     }
+    for (auto& symbol: deferred_symbols) {
+      if (symbol.second.expression) { symbol.second.expression->delete_instance(); }
+    }
   }
 
 }
\ No newline at end of file
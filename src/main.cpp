@@ -1,15 +1,20 @@
+#include "lambda.h"
+#include "strategy.h"
+#include "backend.h"
+#include "progress.h"
+
 #include <iostream>
-#include <stack>
 #include <string.h>
 
-extern FILE* yyin;
-extern int yyparse(FILE*, bool);
-extern std::stack<std::string> include_path_stack;
+extern int yyparse(FILE*, lambda::ReduceOptions&);
+extern bool push_source(const std::string& path);
+extern lambda::Reducer reducer;
 FILE* out = stdout;
-bool display_process = false;
+lambda::ReduceOptions options;
 
 void handle_args(int argc, char** argv) {
-  FILE* in = nullptr;
+  bool has_input = false;
+  bool native_arithmetic = false;
   for (int i = 1; i < argc; i++) {
     if (!strcmp(argv[i], "-o")) {
       if (++i >= argc) {
@@ -18,28 +23,121 @@ void handle_args(int argc, char** argv) {
       out = fopen(argv[i], "w");
     }
     else if (!strcmp(argv[i], "-i")) {
-      display_process = true;
+      options.display_process = true;
+    }
+    else if (!strcmp(argv[i], "-d")) {
+      options.decode_result = true;
+    }
+    else if (!strcmp(argv[i], "--dag")) {
+      options.print_dag = true;
+    }
+    else if (!strcmp(argv[i], "--image")) {
+      options.use_image = true;
+    }
+    else if (!strcmp(argv[i], "--prenormalize")) {
+      if (++i >= argc) {
+        throw std::runtime_error(std::string(argv[0]) + "argument missing for --prenormalize option");
+      }
+      options.prenormalize_budget = std::stoull(argv[i]);
+    }
+    else if (!strcmp(argv[i], "--strategy")) {
+      if (++i >= argc) {
+        throw std::runtime_error(std::string(argv[0]) + "argument missing for --strategy option");
+      }
+      options.strategy = lambda::strategy_from_name(argv[i]);
+    }
+    else if (!strcmp(argv[i], "--engine")) {
+      if (++i >= argc) {
+        throw std::runtime_error(std::string(argv[0]) + "argument missing for --engine option");
+      }
+      options.engine = lambda::engine_from_name(argv[i]);
+    }
+    else if (!strcmp(argv[i], "--stream")) {
+      options.stream_result = true;
+    }
+    else if (!strcmp(argv[i], "--detect-divergence")) {
+      options.detect_divergence = true;
+    }
+    else if (!strcmp(argv[i], "--strictness")) {
+      options.analyze_strictness = true;
+    }
+    else if (!strcmp(argv[i], "--optimize")) {
+      options.optimize = true;
+    }
+    else if (!strcmp(argv[i], "--explicit-substitution")) {
+      options.explicit_substitution = true;
+    }
+    else if (!strcmp(argv[i], "--checkpoint")) {
+      if (++i >= argc) {
+        throw std::runtime_error(std::string(argv[0]) + "argument missing for --checkpoint option");
+      }
+      options.checkpoint_path = argv[i];
+    }
+    else if (!strcmp(argv[i], "--checkpoint-interval")) {
+      if (++i >= argc) {
+        throw std::runtime_error(std::string(argv[0]) + "argument missing for --checkpoint-interval option");
+      }
+      // `1000000` steps or `600s`
+      auto interval = std::string(argv[i]);
+      if (!interval.empty() && interval.back() == 's') {
+        options.checkpoint_steps = 0;
+        options.checkpoint_seconds = std::stoull(interval.substr(0, interval.length() - 1));
+      }
+      else {
+        options.checkpoint_steps = std::stoull(interval);
+      }
+    }
+    else if (!strcmp(argv[i], "--resume")) {
+      if (++i >= argc) {
+        throw std::runtime_error(std::string(argv[0]) + "argument missing for --resume option");
+      }
+      options.resume_path = argv[i];
+    }
+    else if (!strcmp(argv[i], "--progress")) {
+      if (++i >= argc) {
+        throw std::runtime_error(std::string(argv[0]) + "argument missing for --progress option");
+      }
+      options.progress_seconds = std::stoull(argv[i]);
+    }
+    else if (!strcmp(argv[i], "--lazy-imports")) {
+      options.lazy_imports = true;
+    }
+    else if (!strcmp(argv[i], "--native")) {
+      native_arithmetic = true;
     }
     else {
-      include_path_stack.push(argv[1]);
-      in = fopen(argv[1], "r");
-      if (in == nullptr) { 
+      if (!push_source(argv[i])) { 
         throw std::runtime_error(std::string(argv[0]) + "cannot open file"); 
       }
+      has_input = true;
     }
   }
 
-  if (in == nullptr) { 
+  if (!has_input && options.resume_path.empty()) { 
     throw std::runtime_error(std::string(argv[0]) + "no input file specify"); 
   }
-  yyin = in;
+  if (has_input && !options.resume_path.empty()) {
+    throw std::runtime_error(std::string(argv[0]) + "--resume takes no input file");
+  }
+
+  // other strategies may stop at a partially applied operator, which would
+  // print differently from the unfolded definition
+  if (native_arithmetic && options.strategy == lambda::StrategyType::Annotated) {
+    reducer.use_native_arithmetic();
+  }
 }
 
 int main(int argc, char** argv) {
   try {
     handle_args(argc, argv);
+    lambda::handle_progress_signal();
 
-    yyparse(out, display_process);
+    if (!options.resume_path.empty()) {
+      reducer.resume(options.resume_path, out, options)->delete_instance();
+    }
+    else {
+      yyparse(out, options);
+    }
   } 
   catch (std::runtime_error& s) {
     std::cout << s.what() << std::endl;
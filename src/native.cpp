@@ -0,0 +1,263 @@
+#include "native.h"
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <set>
+
+namespace lambda {
+
+  static bool is_number(const std::string& s) {
+    for (auto ch: s) {
+      if (ch < '0' || ch > '9') { return false; }
+    }
+    return !s.empty();
+  }
+
+  // a numeral, nullptr when its Church form would not fit into memory anyway
+  static auto make_numeral(unsigned long long value) -> Expression* {
+    [[unlikely]] if (value > UINT_MAX) { return nullptr; }
+    return new Numeral(value);
+  }
+
+  // `T` or `F` of lib/logic.lambda
+  static auto make_boolean(bool value) -> Expression* {
+    return new Abstraction(
+      Variable("p"),
+      new Abstraction(Variable("q"), new Variable(value ? "p" : "q"))
+    );
+  }
+
+  static const NativeOperator NATIVE_OPERATORS[] = {
+    { "++n", "\\n.\\f.\\x. f (n f x)", 1,
+      [](auto& a) { return make_numeral(a[0] + 1ull); } },
+    { "--n", "\\n.\\f.\\x. n (\\g.\\h. h (g f)) (\\u. x) (\\u. u)", 1,
+      [](auto& a) { return make_numeral(a[0] > 0 ? a[0] - 1 : 0); } },
+    { "+n", "\\m.\\n. m ++n n", 2,
+      [](auto& a) { return make_numeral(a[0] + (unsigned long long)a[1]); } },
+    { "-n", "\\m.\\n. n --n m", 2,
+      [](auto& a) { return make_numeral(a[0] > a[1] ? a[0] - a[1] : 0); } },
+    { "*n", "\\m.\\n. m (+n n) 0", 2,
+      [](auto& a) { return make_numeral(a[0] * (unsigned long long)a[1]); } },
+    { "0n?", "\\n. n (\\x. F) T", 1,
+      [](auto& a) { return make_boolean(a[0] == 0); } },
+    { "<=n", "\\m.\\n. 0n? (-n m n)", 2,
+      [](auto& a) { return make_boolean(a[0] <= a[1]); } },
+    { ">=n", "\\m.\\n. 0n? (-n n m)", 2,
+      [](auto& a) { return make_boolean(a[0] >= a[1]); } },
+    { "=n", "\\m.\\n. (\\m.\\n. & (<=n m n) (>=n m n)) m n", 2,
+      [](auto& a) { return make_boolean(a[0] == a[1]); } },
+    { "!=n", "\\m.\\n. ! (=n m n)", 2,
+      [](auto& a) { return make_boolean(a[0] != a[1]); } },
+    { "<n", "\\m.\\n. <=n (++n m) n", 2,
+      [](auto& a) { return make_boolean(a[0] < a[1]); } },
+    { ">n", "\\m.\\n. >=n m (++n n)", 2,
+      [](auto& a) { return make_boolean(a[0] > a[1]); } },
+    { "%n", "\\m.\\n. (\\m.\\n. <n m n m (%n (-n m n) n)) m n", 2,
+      [](auto& a) { return a[1] == 0 ? nullptr : make_numeral(a[0] % a[1]); } },
+  };
+
+  // the symbols of lib/logic.lambda the operators refer to, which are not
+  // computed natively themselves
+  static const std::pair<const char*, const char*> LIBRARY_SYMBOLS[] = {
+    { "T", "\\p.\\q. p" },
+    { "F", "\\p.\\q. q" },
+    { "&", "\\p.\\q. p q p" },
+    { "!", "\\p. p F T" },
+  };
+
+  // the term a definition of the table is written as, which is printed by
+  // `to_string` and so has parentheses around every argument but variables
+  class DefinitionReader {
+  public:
+    DefinitionReader(const char* text): text(text) {}
+
+    auto read() -> Expression* {
+      if (*text == '\\') {
+        text++;
+        auto binder = identifier();
+        text++;
+        if (*text == ' ') { text++; }
+        return new Abstraction(Variable(binder), read());
+      }
+
+      auto result = atom();
+      while (*text == ' ') {
+        text++;
+        result = new Application(result, atom());
+      }
+      return result;
+    }
+
+  private:
+    const char* text;
+
+    auto identifier() -> std::string {
+      auto begin = text;
+      while (*text != '\0' && !strchr(" \\.()", *text)) { text++; }
+      return std::string(begin, text);
+    }
+
+    auto atom() -> Expression* {
+      if (*text != '(') { return new Variable(identifier()); }
+      text++;
+      auto result = read();
+      text++;
+      return result;
+    }
+  };
+
+  // binders around the terms compared, innermost last
+  using Binders = std::vector<std::string>;
+
+  static auto find_binder(const Binders& binders, const std::string& literal) -> size_t {
+    for (auto i = binders.size(); i-- > 0;) {
+      if (binders[i] == literal) { return i; }
+    }
+    return SIZE_MAX;
+  }
+
+  // equal up to the names of bound variables. computational priorities are
+  // left out, as the ones of the library do not change what it computes
+  static bool is_alpha_equivalent(
+    Expression* a,
+    Expression* b,
+    Binders& a_binders,
+    Binders& b_binders
+  ) {
+    if (auto root = dynamic_cast<Root*>(a)) {
+      return is_alpha_equivalent(root->get_expression(), b, a_binders, b_binders);
+    }
+
+    if (auto variable = dynamic_cast<Variable*>(a)) {
+      auto other = dynamic_cast<Variable*>(b);
+      if (other == nullptr) { return false; }
+      auto position = find_binder(a_binders, variable->get_literal());
+      if (position != find_binder(b_binders, other->get_literal())) { return false; }
+      return position != SIZE_MAX || variable->get_literal() == other->get_literal();
+    }
+    if (auto abstraction = dynamic_cast<Abstraction*>(a)) {
+      auto other = dynamic_cast<Abstraction*>(b);
+      if (other == nullptr) { return false; }
+      a_binders.push_back(abstraction->get_binder().get_literal());
+      b_binders.push_back(other->get_binder().get_literal());
+      auto result = is_alpha_equivalent(
+        abstraction->get_body(), other->get_body(), a_binders, b_binders
+      );
+      a_binders.pop_back();
+      b_binders.pop_back();
+      return result;
+    }
+    if (auto application = dynamic_cast<Application*>(a)) {
+      auto other = dynamic_cast<Application*>(b);
+      return other != nullptr
+        && is_alpha_equivalent(
+          application->get_first(), other->get_first(), a_binders, b_binders
+        )
+        && is_alpha_equivalent(
+          application->get_second(), other->get_second(), a_binders, b_binders
+        );
+    }
+    return false;
+  }
+
+  static void collect_free_literals(
+    Expression* expression,
+    Binders& binders,
+    std::set<std::string>& literals
+  ) {
+    if (auto variable = dynamic_cast<Variable*>(expression)) {
+      if (find_binder(binders, variable->get_literal()) == SIZE_MAX) {
+        literals.insert(variable->get_literal());
+      }
+    }
+    else if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      binders.push_back(abstraction->get_binder().get_literal());
+      collect_free_literals(abstraction->get_body(), binders, literals);
+      binders.pop_back();
+    }
+    else if (auto application = dynamic_cast<Application*>(expression)) {
+      collect_free_literals(application->get_first(), binders, literals);
+      collect_free_literals(application->get_second(), binders, literals);
+    }
+  }
+
+  static bool is_library_definition(
+    const std::string& literal,
+    Expression* definition,
+    const char* text,
+    const std::map<std::string, Expression*>& symbol_table,
+    std::set<std::string>& checked
+  );
+
+  // `literal` is defined in `symbol_table` as the library defines it: a
+  // native operator by its primitive, the others by their library terms.
+  // `checked` holds the symbols taken as such already, so that recursive
+  // definitions stop
+  static bool is_library_symbol(
+    const std::string& literal,
+    const std::map<std::string, Expression*>& symbol_table,
+    std::set<std::string>& checked
+  ) {
+    // numerals are never looked up
+    if (checked.count(literal) > 0 || is_number(literal)) { return true; }
+
+    auto it = symbol_table.find(literal);
+    if (it == symbol_table.end()) { return false; }
+
+    for (auto& native_operator: NATIVE_OPERATORS) {
+      if (literal != native_operator.literal) { continue; }
+      auto primitive = dynamic_cast<Primitive*>(it->second);
+      return primitive != nullptr
+        && primitive->get_native_operator() == &native_operator;
+    }
+    for (auto& [symbol, text]: LIBRARY_SYMBOLS) {
+      if (literal != symbol) { continue; }
+      return is_library_definition(literal, it->second, text, symbol_table, checked);
+    }
+    return false;
+  }
+
+  static bool is_library_definition(
+    const std::string& literal,
+    Expression* definition,
+    const char* text,
+    const std::map<std::string, Expression*>& symbol_table,
+    std::set<std::string>& checked
+  ) {
+    auto expected = DefinitionReader(text).read();
+    Binders binders, expected_binders;
+    auto is_matched = is_alpha_equivalent(
+      definition, expected, binders, expected_binders
+    );
+
+    std::set<std::string> literals;
+    if (is_matched) { collect_free_literals(expected, binders, literals); }
+    expected->delete_instance();
+
+    checked.insert(literal);
+    for (auto& referred: literals) {
+      if (!is_matched) { break; }
+      is_matched = is_library_symbol(referred, symbol_table, checked);
+    }
+    return is_matched;
+  }
+
+  auto find_native_operator(
+    const std::string& literal,
+    Expression* definition,
+    const std::map<std::string, Expression*>& symbol_table
+  ) -> const NativeOperator* {
+    for (auto& native_operator: NATIVE_OPERATORS) {
+      if (literal != native_operator.literal) { continue; }
+
+      std::set<std::string> checked;
+      auto is_matched = is_library_definition(
+        literal, definition, native_operator.definition, symbol_table, checked
+      );
+      return is_matched ? &native_operator : nullptr;
+    }
+    return nullptr;
+  }
+
+}
@@ -0,0 +1,585 @@
+#include "net.h"
+
+#include <cstdlib>
+#include <utility>
+#include <stdexcept>
+
+namespace lambda {
+
+  static bool is_number(const std::string& s) {
+    for (auto ch: s) {
+      if (ch < '0' || ch > '9') { return false; }
+    }
+    return !s.empty();
+  }
+
+  static auto index_to_string(unsigned index) -> std::string {
+    constexpr unsigned LETTER_N = 26;
+    auto result = std::string("");
+
+    for (; index >= LETTER_N; index /= LETTER_N) {
+      result += 'a' + index % LETTER_N;
+    }
+    result += 'a' + index % LETTER_N;
+
+    return result;
+  }
+
+
+  auto NetBackend::port(uint32_t node, uint32_t slot) -> Port {
+    return node << 2 | slot;
+  }
+
+  auto NetBackend::node_of(Port port) -> uint32_t {
+    return port >> 2;
+  }
+
+  auto NetBackend::slot_of(Port port) -> uint32_t {
+    return port & 3;
+  }
+
+  auto NetBackend::enter(Port port) -> Port {
+    return nodes[node_of(port)].ports[slot_of(port)];
+  }
+
+  void NetBackend::link(Port a, Port b) {
+    nodes[node_of(a)].ports[slot_of(a)] = b;
+    nodes[node_of(b)].ports[slot_of(b)] = a;
+  }
+
+  auto NetBackend::make_node(Kind kind, uint32_t label, int32_t level) -> uint32_t {
+    uint32_t node;
+    if (free_nodes.empty()) {
+      node = nodes.size();
+      nodes.emplace_back();
+    }
+    else {
+      node = free_nodes.back();
+      free_nodes.pop_back();
+    }
+
+    nodes[node].kind = kind;
+    nodes[node].label = label;
+    nodes[node].level = level;
+    // the auxiliary ports of agents that have none are tied to each other
+    link(port(node, 1), port(node, 2));
+    return node;
+  }
+
+  void NetBackend::free_node(uint32_t node) {
+    free_nodes.push_back(node);
+  }
+
+  auto NetBackend::name_index(const std::string& name) -> uint32_t {
+    auto [it, inserted] = name_indices.emplace(name, names.size());
+    if (inserted) { names.push_back(name); }
+    return it->second;
+  }
+
+  // fans, croissants, brackets and erasers
+  bool NetBackend::is_agent(Kind kind) {
+    return kind >= Kind::Fan;
+  }
+
+  auto NetBackend::arity(Kind kind) -> uint32_t {
+    switch (kind) {
+      case Kind::Lambda:
+      case Kind::Application:
+      case Kind::Fan:
+        return 2;
+      case Kind::Croissant:
+      case Kind::Bracket:
+        return 1;
+      default:
+        return 0;
+    }
+  }
+
+
+  auto NetBackend::encode(
+    Expression* expression,
+    int32_t level,
+    std::multiset<std::string>& bound_variables,
+    std::map<std::string, Port>& free_ports
+  ) -> Port {
+    if (auto root = dynamic_cast<Root*>(expression)) {
+      return encode(root->get_expression(), level, bound_variables, free_ports);
+    }
+
+    if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      auto& literal = abstraction->get_binder().get_literal();
+      auto lambda = make_node(Kind::Lambda, name_index(literal), level);
+
+      auto it = bound_variables.insert(literal);
+      auto body = encode(abstraction->get_body(), level, bound_variables, free_ports);
+      bound_variables.erase(it);
+      link(port(lambda, 2), body);
+
+      auto variable = free_ports.find(literal);
+      if (variable != free_ports.end()) {
+        link(port(lambda, 1), variable->second);
+        free_ports.erase(variable);
+      }
+      else {
+        link(port(lambda, 1), port(make_node(Kind::Eraser, 0, 0), 0));
+      }
+      return port(lambda, 0);
+    }
+
+    if (auto application = dynamic_cast<Application*>(expression)) {
+      auto node = make_node(Kind::Application, 0, level);
+      link(
+        port(node, 0),
+        encode(application->get_first(), level, bound_variables, free_ports)
+      );
+
+      std::map<std::string, Port> argument_ports;
+      link(
+        port(node, 1),
+        encode(application->get_second(), level + 1, bound_variables, argument_ports)
+      );
+
+      // the variables of the argument leave its box through a bracket each,
+      // and are shared with the function through a fan
+      for (auto& [literal, argument_port]: argument_ports) {
+        auto bracket = make_node(Kind::Bracket, 0, level);
+        link(port(bracket, 1), argument_port);
+
+        auto it = free_ports.find(literal);
+        if (it == free_ports.end()) {
+          free_ports.emplace(literal, port(bracket, 0));
+          continue;
+        }
+        auto fan = make_node(Kind::Fan, 0, level);
+        link(port(fan, 1), it->second);
+        link(port(fan, 2), port(bracket, 0));
+        it->second = port(fan, 0);
+      }
+      return port(node, 2);
+    }
+
+    if (auto numeral = dynamic_cast<Numeral*>(expression)) {
+      return encode_numeral(numeral->get_value(), level);
+    }
+
+    if (auto primitive = dynamic_cast<Primitive*>(expression)) {
+      auto expanded = primitive->expand();
+      auto result = encode(expanded, level, bound_variables, free_ports);
+      expanded->delete_instance();
+      return result;
+    }
+
+    auto& literal = static_cast<Variable*>(expression)->get_literal();
+
+    if (bound_variables.count(literal) > 0) {
+      auto croissant = make_node(Kind::Croissant, 0, level);
+      free_ports.emplace(literal, port(croissant, 0));
+      return port(croissant, 1);
+    }
+
+    if (is_number(literal)) {
+      return encode_numeral(std::atoi(literal.c_str()), level);
+    }
+
+    if (symbol_table->count(literal) > 0) {
+      return port(make_node(Kind::Reference, name_index(literal), level), 0);
+    }
+
+    free_literals.insert(literal);
+    return port(make_node(Kind::Free, name_index(literal), level), 0);
+  }
+
+  auto NetBackend::encode_numeral(unsigned value, int32_t level) -> Port {
+    auto numeral = new Numeral(value);
+    auto church = numeral->expand();
+    numeral->delete_instance();
+    std::multiset<std::string> bound_variables;
+    std::map<std::string, Port> free_ports;
+    auto result = encode(church, level, bound_variables, free_ports);
+    church->delete_instance();
+    return result;
+  }
+
+
+
+
+  bool NetBackend::is_active(uint32_t a, uint32_t b) {
+    auto kind_a = nodes[a].kind;
+    auto kind_b = nodes[b].kind;
+    if (kind_a > kind_b) { std::swap(kind_a, kind_b); }
+
+    if (kind_a == Kind::Root) { return false; }
+    if (is_agent(kind_b)) { return true; }
+    return (kind_a == Kind::Lambda && kind_b == Kind::Application)
+      || (kind_a == Kind::Application && kind_b == Kind::Reference);
+  }
+
+  void NetBackend::rewrite(uint32_t a, uint32_t b) {
+    if (nodes[a].kind > nodes[b].kind) { std::swap(a, b); }
+
+    switch (nodes[b].kind) {
+      case Kind::Application:
+        beta_count++;
+        annihilate(a, b);
+        return;
+      case Kind::Reference:
+        unfold(b);
+        return;
+      case Kind::Eraser:
+        erase_count++;
+        commute(b, a);
+        return;
+      default:
+        break;
+    }
+
+    // of two agents, the one of the lower level passes through the other
+    if (is_agent(nodes[a].kind)) {
+      if (nodes[a].level == nodes[b].level) {
+        if (nodes[a].kind != nodes[b].kind) {
+          throw std::runtime_error("the net cannot be reduced, agents of one level meet");
+        }
+        (nodes[a].kind == Kind::Fan ? fan_count : bracket_count)++;
+        annihilate(a, b);
+        return;
+      }
+      if (nodes[a].level < nodes[b].level) { std::swap(a, b); }
+    }
+    (nodes[b].kind == Kind::Fan ? fan_count : bracket_count)++;
+    commute(b, a);
+  }
+
+  // the auxiliary ports of `a` are connected to those of `b`. for a lambda
+  // and an application, the argument takes the place of the variable and the
+  // body that of the result
+  void NetBackend::annihilate(uint32_t a, uint32_t b) {
+    for (uint32_t slot = 1; slot <= arity(nodes[a].kind); slot++) {
+      link(enter(port(a, slot)), enter(port(b, slot)));
+    }
+    free_node(a);
+    free_node(b);
+  }
+
+  void NetBackend::commute(uint32_t agent, uint32_t node) {
+    auto agent_arity = arity(nodes[agent].kind);
+    auto node_arity = arity(nodes[node].kind);
+
+    // a fan copies what it crosses, a croissant lowers its level and a
+    // bracket raises it
+    auto level = nodes[node].level;
+    if (nodes[agent].kind == Kind::Croissant) { level--; }
+    if (nodes[agent].kind == Kind::Bracket) { level++; }
+
+    uint32_t node_copies[2], agent_copies[2];
+    for (uint32_t i = 0; i < agent_arity; i++) {
+      node_copies[i] = make_node(nodes[node].kind, nodes[node].label, level);
+    }
+    for (uint32_t i = 0; i < node_arity; i++) {
+      agent_copies[i] = make_node(
+        nodes[agent].kind, nodes[agent].label, nodes[agent].level
+      );
+    }
+
+    // a port of `agent` or `node` that the other one is linked to stands
+    // for the copy that takes its place
+    auto outside = [&](Port other) -> Port {
+      if (node_of(other) == agent && slot_of(other) > 0) {
+        return port(node_copies[slot_of(other) - 1], 0);
+      }
+      if (node_of(other) == node && slot_of(other) > 0) {
+        return port(agent_copies[slot_of(other) - 1], 0);
+      }
+      return other;
+    };
+
+    for (uint32_t i = 0; i < agent_arity; i++) {
+      link(port(node_copies[i], 0), outside(enter(port(agent, i + 1))));
+    }
+    for (uint32_t i = 0; i < node_arity; i++) {
+      link(port(agent_copies[i], 0), outside(enter(port(node, i + 1))));
+    }
+    for (uint32_t i = 0; i < agent_arity; i++) {
+      for (uint32_t j = 0; j < node_arity; j++) {
+        link(port(node_copies[i], j + 1), port(agent_copies[j], i + 1));
+      }
+    }
+
+    free_node(agent);
+    free_node(node);
+  }
+
+  void NetBackend::unfold(uint32_t reference) {
+    unfold_count++;
+
+    auto target = enter(port(reference, 0));
+    auto definition = symbol_table->at(names[nodes[reference].label]);
+    auto level = nodes[reference].level;
+    free_node(reference);
+
+    std::multiset<std::string> bound_variables;
+    std::map<std::string, Port> free_ports;
+    link(encode(definition, level, bound_variables, free_ports), target);
+  }
+
+
+  bool NetBackend::reduce_at(Port principal) {
+    // principal ports that wait for the node on their other side, an
+    // application or an agent reached by an auxiliary port, to be rewritten
+    struct Frame {
+      Port port;
+      bool waiting;
+    };
+    std::vector<Frame> stack = { { principal, false } };
+    bool rewritten = false;
+
+    while (!stack.empty()) {
+      auto& frame = stack.back();
+      if (frame.waiting) {
+        frame.waiting = false;
+        if (!rewritten) {
+          stack.pop_back();
+          continue;
+        }
+      }
+
+      auto node = node_of(frame.port);
+      auto other = enter(frame.port);
+      auto other_node = node_of(other);
+
+      if (slot_of(other) == 0) {
+        rewritten = is_active(node, other_node);
+        if (rewritten) { rewrite(node, other_node); }
+        stack.pop_back();
+        continue;
+      }
+
+      auto other_kind = nodes[other_node].kind;
+      if (
+        (is_agent(other_kind) && other_kind != Kind::Eraser)
+        || (other_kind == Kind::Application && slot_of(other) == 2)
+      ) {
+        // more waiting ports than nodes can only be a cycle
+        if (stack.size() > nodes.size()) {
+          throw std::runtime_error("the net cannot be reduced, it has a vicious circle");
+        }
+        frame.waiting = true;
+        stack.push_back({ port(other_node, 0), false });
+        continue;
+      }
+
+      rewritten = false;
+      stack.pop_back();
+    }
+
+    return rewritten;
+  }
+
+
+
+  auto NetBackend::level_at(const Context& context, int32_t index) -> LevelPtr {
+    if (index < 0) { throw std::runtime_error("the net cannot be read back"); }
+    return (size_t)index < context.size() ? context[index] : nullptr;
+  }
+
+  bool NetBackend::is_same_level(const LevelPtr& a, const LevelPtr& b) {
+    if (a == b) { return true; }
+    if (!a || !b || a->tag != b->tag || a->slot != b->slot) { return false; }
+    return is_same_level(a->first, b->first) && is_same_level(a->second, b->second);
+  }
+
+  // a fan pops the port it leaves by from its level, a croissant removes
+  // its level and a bracket splits it in two
+  auto NetBackend::leave_agent(uint32_t node, Context& context) -> uint32_t {
+    auto index = nodes[node].level;
+    auto level = level_at(context, index);
+    if (context.size() <= (size_t)index) { context.resize(index + 1); }
+
+    switch (nodes[node].kind) {
+      case Kind::Fan:
+        if (!level || level->tag != Level::Tag::Choice) {
+          throw std::runtime_error("the net cannot be read back");
+        }
+        context[index] = level->first;
+        return level->slot;
+
+      case Kind::Croissant:
+        context.erase(context.begin() + index);
+        return 1;
+
+      default: {
+        LevelPtr first, second;
+        if (level) {
+          if (level->tag != Level::Tag::Pair) {
+            throw std::runtime_error("the net cannot be read back");
+          }
+          first = level->first;
+          second = level->second;
+        }
+        context[index] = first;
+        context.insert(context.begin() + index + 1, second);
+        return 1;
+      }
+    }
+  }
+
+  void NetBackend::enter_agent(uint32_t node, uint32_t slot, Context& context) {
+    auto index = nodes[node].level;
+    auto level = level_at(context, index);
+    if (context.size() <= (size_t)index) { context.resize(index + 1); }
+
+    switch (nodes[node].kind) {
+      case Kind::Fan:
+        context[index] = std::make_shared<const Level>(
+          Level { Level::Tag::Choice, slot, level, nullptr }
+        );
+        return;
+
+      case Kind::Croissant:
+        context.insert(
+          context.begin() + index,
+          std::make_shared<const Level>(Level { Level::Tag::Mark, 0, nullptr, nullptr })
+        );
+        return;
+
+      default: {
+        auto second = level_at(context, index + 1);
+        if (context.size() > (size_t)index + 1) {
+          context.erase(context.begin() + index + 1);
+        }
+        context[index] = level || second
+          ? std::make_shared<const Level>(Level { Level::Tag::Pair, 0, level, second })
+          : nullptr;
+        return;
+      }
+    }
+  }
+
+  // the copy of a lambda a variable belongs to is told by the levels below
+  // that of the lambda, which only what is outside of it changes
+  auto NetBackend::find_binder(
+    uint32_t node,
+    const Context& context,
+    const std::vector<Binder>& binders
+  ) -> std::string {
+    auto level = nodes[node].level;
+    for (auto it = binders.rbegin(); it != binders.rend(); it++) {
+      if (it->node != node) { continue; }
+
+      bool is_same = true;
+      for (int32_t i = 0; i < level && is_same; i++) {
+        is_same = is_same_level(level_at(it->context, i), level_at(context, i));
+      }
+      if (is_same) { return it->literal; }
+    }
+    throw std::runtime_error("the net cannot be read back, a variable has no binder");
+  }
+
+  auto NetBackend::read_back(
+    Port port,
+    Context context,
+    std::vector<Binder>& binders,
+    std::multiset<std::string>& bound_variables
+  ) -> Expression* {
+    // agents crossed on the way to the next lambda or application
+    unsigned long long crossed = 0;
+
+    for (;;) {
+      auto other = enter(port);
+      auto node = node_of(other);
+      auto slot = slot_of(other);
+
+      switch (nodes[node].kind) {
+        case Kind::Lambda: {
+          if (slot == 1) {
+            return new Variable(find_binder(node, context, binders));
+          }
+          if (slot == 2) {
+            throw std::runtime_error("the net cannot be read back");
+          }
+
+          auto literal = names[nodes[node].label];
+          for (unsigned i = 0;
+            bound_variables.count(literal) > 0 || free_literals.count(literal) > 0;
+            i++
+          ) {
+            literal = index_to_string(i);
+          }
+
+          binders.push_back({ node, context, literal });
+          auto it = bound_variables.insert(literal);
+          auto body = read_back(NetBackend::port(node, 2), context, binders, bound_variables);
+          bound_variables.erase(it);
+          binders.pop_back();
+          return new Abstraction(Variable(literal), body);
+        }
+
+        case Kind::Application: {
+          if (slot != 2) {
+            throw std::runtime_error("the net cannot be read back");
+          }
+          if (reduce_at(NetBackend::port(node, 0))) { continue; }
+
+          auto first = read_back(NetBackend::port(node, 0), context, binders, bound_variables);
+          auto second = read_back(NetBackend::port(node, 1), context, binders, bound_variables);
+          return new Application(first, second);
+        }
+
+        case Kind::Fan:
+        case Kind::Croissant:
+        case Kind::Bracket:
+          if (++crossed > 16 * (unsigned long long)nodes.size()) {
+            throw std::runtime_error("the net cannot be read back, it has a vicious circle");
+          }
+
+          if (slot == 0) {
+            port = NetBackend::port(node, leave_agent(node, context));
+            continue;
+          }
+
+          if (reduce_at(NetBackend::port(node, 0))) { continue; }
+          enter_agent(node, slot, context);
+          port = NetBackend::port(node, 0);
+          continue;
+
+        case Kind::Reference:
+          unfold(node);
+          continue;
+
+        case Kind::Free:
+          return new Variable(names[nodes[node].label]);
+
+        default:
+          throw std::runtime_error("the net cannot be read back");
+      }
+    }
+  }
+
+  auto NetBackend::normalize(
+    Expression* expression,
+    std::map<std::string, Expression*>& symbol_table,
+    unsigned long long& step
+  ) -> Expression* {
+    this->symbol_table = &symbol_table;
+
+    auto root = make_node(Kind::Root, 0, 0);
+    std::multiset<std::string> bound_variables;
+    std::map<std::string, Port> free_ports;
+    link(port(root, 0), encode(expression, 0, bound_variables, free_ports));
+
+    std::vector<Binder> binders;
+    auto result = read_back(port(root, 0), {}, binders, bound_variables);
+
+    step = beta_count + fan_count + bracket_count + unfold_count + erase_count;
+    return new Root(result);
+  }
+
+  auto NetBackend::get_statistics() -> std::string {
+    return std::to_string(beta_count) + " beta, "
+      + std::to_string(fan_count) + " fan, "
+      + std::to_string(bracket_count) + " bracket, "
+      + std::to_string(unfold_count) + " unfold, "
+      + std::to_string(erase_count) + " erase, "
+      + std::to_string(nodes.size()) + " nodes";
+  }
+
+}
@@ -0,0 +1,201 @@
+#include "optimizer.h"
+
+namespace lambda {
+
+  static bool is_number(const std::string& literal) {
+    for (auto ch: literal) {
+      if (ch < '0' || ch > '9') { return false; }
+    }
+    return !literal.empty();
+  }
+
+  // free occurrences of `literal`, counted up to `limit`
+  static auto count_occurrences(
+    Expression* expression,
+    const std::string& literal,
+    unsigned limit
+  ) -> unsigned {
+    if (auto variable = dynamic_cast<Variable*>(expression)) {
+      return variable->get_literal() == literal ? 1 : 0;
+    }
+    if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      if (abstraction->get_binder().get_literal() == literal) { return 0; }
+      return count_occurrences(abstraction->get_body(), literal, limit);
+    }
+    if (auto application = dynamic_cast<Application*>(expression)) {
+      auto count = count_occurrences(application->get_first(), literal, limit);
+      if (count >= limit) { return count; }
+      return count + count_occurrences(application->get_second(), literal, limit);
+    }
+    return 0;
+  }
+
+  static void append(std::string& report, unsigned long long count, const char* what) {
+    if (count == 0) { return; }
+    if (!report.empty()) { report += ", "; }
+    report += std::to_string(count) + " " + what;
+  }
+
+  Optimizer::Optimizer(Reducer& reducer): reducer(reducer) {}
+
+  auto Optimizer::optimize(
+    const std::string& literal,
+    Expression*& expression
+  ) -> std::string {
+    contracted_count = 0;
+    dropped_count = 0;
+    eta_count = 0;
+
+    // `literal` may still have an older definition
+    if (!literal.empty()) { visiting.insert(literal); }
+    BoundVariables bound_variables;
+    rewrite(expression, bound_variables);
+    visiting.erase(literal);
+
+    std::string report;
+    append(report, contracted_count, "redexes contracted");
+    append(report, dropped_count, "arguments dropped");
+    append(report, eta_count, "eta reductions");
+    return report;
+  }
+
+  void Optimizer::rewrite(
+    Expression*& expression,
+    BoundVariables& bound_variables
+  ) {
+    if (auto root = dynamic_cast<Root*>(expression)) {
+      rewrite(root->get_expression(), bound_variables);
+    }
+    else if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      auto it = bound_variables.emplace(abstraction->get_binder().get_literal());
+      rewrite(abstraction->get_body(), bound_variables);
+      bound_variables.erase(it);
+
+      eta_reduce(expression, bound_variables);
+    }
+    else if (auto application = dynamic_cast<Application*>(expression)) {
+      rewrite(application->get_first(), bound_variables);
+      rewrite(application->get_second(), bound_variables);
+
+      // what is substituted may make new redexes. every contraction removes
+      // an abstraction, so this ends
+      if (contract(expression, bound_variables)) {
+        rewrite(expression, bound_variables);
+      }
+    }
+  }
+
+  bool Optimizer::contract(
+    Expression*& expression,
+    BoundVariables& bound_variables
+  ) {
+    auto application = dynamic_cast<Application*>(expression);
+    if (application == nullptr) { return false; }
+    auto abstraction = dynamic_cast<Abstraction*>(application->get_first());
+    if (abstraction == nullptr) { return false; }
+
+    auto argument = application->get_second();
+    auto priority = argument->get_computational_priority();
+    if (
+      priority == ComputationalPriority::Eager
+      || priority == ComputationalPriority::HeadEager
+    ) {
+      return false;
+    }
+
+    // copying a variable duplicates no work, nor does substituting once
+    auto occurrences = count_occurrences(
+      abstraction->get_body(), abstraction->get_binder().get_literal(), 2
+    );
+    if (occurrences > 1 && dynamic_cast<Variable*>(argument) == nullptr) {
+      return false;
+    }
+
+    auto [new_expr, reduce_type] = application->contract(bound_variables);
+    if (!(bool)reduce_type) { return false; }
+
+    expression = new_expr;
+    if (occurrences == 0) { dropped_count++; }
+    else { contracted_count++; }
+    return true;
+  }
+
+  bool Optimizer::eta_reduce(
+    Expression*& expression,
+    BoundVariables& bound_variables
+  ) {
+    auto abstraction = dynamic_cast<Abstraction*>(expression);
+    if (abstraction == nullptr) { return false; }
+    auto application = dynamic_cast<Application*>(abstraction->get_body());
+    if (application == nullptr) { return false; }
+
+    auto& binder = abstraction->get_binder().get_literal();
+    auto variable = dynamic_cast<Variable*>(application->get_second());
+    if (variable == nullptr || variable->get_literal() != binder) { return false; }
+    // `\x. M {x}` reduces what is passed before `M` sees it
+    if (variable->get_computational_priority() != ComputationalPriority::Neutral) {
+      return false;
+    }
+
+    auto function = application->get_first();
+    if (function->is_variable_free(binder)) { return false; }
+
+    // `\x. f x` is in normal form while `f` is a different one. when `M`
+    // reduces to `\y. N`, `\x. M x` reduces to `\x. N[y := x]` instead
+    if (arity(function, bound_variables) == 0) { return false; }
+
+    auto computational_priority = abstraction->get_computational_priority();
+    application->get_first() = new Variable(binder);
+    abstraction->delete_instance();
+
+    function->set_computational_priority(computational_priority);
+    expression = function;
+    eta_count++;
+    return true;
+  }
+
+  auto Optimizer::arity(
+    Expression* expression,
+    BoundVariables& bound_variables
+  ) -> unsigned {
+    unsigned argument_count = 0;
+    while (auto application = dynamic_cast<Application*>(expression)) {
+      argument_count++;
+      expression = application->get_first();
+    }
+
+    unsigned head_arity = 0;
+    if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      auto it = bound_variables.emplace(abstraction->get_binder().get_literal());
+      head_arity = 1 + arity(abstraction->get_body(), bound_variables);
+      bound_variables.erase(it);
+    }
+    else if (dynamic_cast<Numeral*>(expression) != nullptr) {
+      head_arity = 2;
+    }
+    else if (auto variable = dynamic_cast<Variable*>(expression)) {
+      auto& literal = variable->get_literal();
+      if (bound_variables.count(literal) > 0) { return 0; }
+
+      if (is_number(literal)) {
+        head_arity = 2;
+      }
+      else if (visiting.count(literal) == 0) {
+        // definitions are closed but for symbols
+        auto definition = reducer.find_symbol(literal);
+        if (definition != nullptr) {
+          BoundVariables none;
+          visiting.insert(literal);
+          head_arity = arity(definition, none);
+          visiting.erase(literal);
+        }
+      }
+    }
+    else if (auto root = dynamic_cast<Root*>(expression)) {
+      head_arity = arity(root->get_expression(), bound_variables);
+    }
+
+    return head_arity > argument_count ? head_arity - argument_count : 0;
+  }
+
+}
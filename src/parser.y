@@ -2,27 +2,78 @@
   #include "lambda.h"
   
   #include <memory>
+  #include <stdexcept>
 
   int yylex();
-  void yyerror(FILE* out, bool display_process, const char* s);
+  void yyerror(FILE* out, lambda::ReduceOptions& options, const char* s);
+
+  // optimize, prenormalize and annotate a definition as asked, then
+  // register it
+  void define_symbol(
+    FILE* out,
+    lambda::ReduceOptions& options,
+    const std::string& literal,
+    lambda::Expression*& expression
+  );
 }
 
 %parse-param  { FILE* out }
-%parse-param  { bool display_process }
+%parse-param  { lambda::ReduceOptions& options }
 
 %{
   #include "lambda.h"
+  #include "image.h"
+  #include "strictness.h"
+  #include "optimizer.h"
+
+  #include <queue>
+
+  extern std::queue<std::string> definition_origins;
+  extern std::string input_path;
 
   lambda::Reducer reducer;
+  lambda::ImageBuilder image_builder;
+  lambda::StrictnessAnalyzer strictness_analyzer(reducer);
+  lambda::Optimizer optimizer(reducer);
+
+  void define_symbol(
+    FILE* out,
+    lambda::ReduceOptions& options,
+    const std::string& literal,
+    lambda::Expression*& expression
+  ) {
+    if (options.optimize) {
+      auto report = optimizer.optimize(literal, expression);
+      if (!report.empty()) {
+        fprintf(out, "optimized:        %s, %s\n", literal.c_str(), report.c_str());
+      }
+    }
+    if (options.prenormalize_budget > 0) {
+      auto step = reducer.prenormalize(literal, expression, options.prenormalize_budget);
+      if (step > 0) {
+        fprintf(
+          out, "prenormalized:    %s, %llu steps saved per unfolding\n",
+          literal.c_str(), step
+        );
+      }
+    }
+    if (options.analyze_strictness) {
+      auto report = strictness_analyzer.annotate(literal, expression);
+      if (!report.empty()) {
+        fprintf(out, "strictness:       %s, %s\n", literal.c_str(), report.c_str());
+      }
+    }
+    reducer.register_symbol(literal, expression);
+  }
 %}
 
 %union {
-  char String[4096];
+  const std::string* Identifier;
   lambda::Expression* LambdaExpression;
   lambda::Variable*   LambdaVariable;
 }
 
-%token  <String> TK_IDENTIFIER
+%token  <Identifier> TK_IDENTIFIER
 %token  TK_DEFINE
 
 %type <LambdaExpression> expression abstraction application atomic
@@ -31,7 +82,9 @@
 %%
 
 comp_unit
-  : commands
+  : commands {
+    if (options.use_image) { image_builder.save(); }
+  }
 ;
 
 commands
@@ -46,14 +99,50 @@ command
 
 definition
   : '#' TK_IDENTIFIER TK_DEFINE expression {
-    reducer.register_symbol($2, $4);
+    auto origin = definition_origins.front();
+    definition_origins.pop();
+
+    if (options.lazy_imports && origin != input_path) {
+      if (options.use_image) {
+        image_builder.add_symbol(origin, *$2, $4);
+      }
+      auto literal = *$2;
+      reducer.defer_symbol(literal, $4, nullptr, [out, &options, literal](
+        lambda::Expression* expression
+      ) {
+        define_symbol(out, options, literal, expression);
+      });
+    }
+    else {
+      // the imports it refers to are deferred still
+      reducer.materialize($4);
+      // images keep the body as parsed, `define_symbol` rewrites it
+      if (options.use_image) {
+        image_builder.add_symbol(origin, *$2, $4);
+      }
+      define_symbol(out, options, *$2, $4);
+    }
   }
 ;
 
 solution
   : '@' expression { 
     auto expression = new lambda::Root($2);
-    reducer.reduce(expression, out, display_process); 
+    reducer.materialize(expression);
+    if (options.optimize) {
+      lambda::Expression* optimized = expression;
+      auto report = optimizer.optimize("", optimized);
+      if (!report.empty()) {
+        fprintf(out, "optimized:        @, %s\n", report.c_str());
+      }
+    }
+    if (options.analyze_strictness) {
+      auto report = strictness_analyzer.annotate("", expression);
+      if (!report.empty()) {
+        fprintf(out, "strictness:       @, %s\n", report.c_str());
+      }
+    }
+    reducer.reduce(expression, out, options); 
   }
 ;
 
@@ -88,11 +177,11 @@ atomic
 ;
 
 variable
-  : TK_IDENTIFIER { $$ = new lambda::Variable($1); }
+  : TK_IDENTIFIER { $$ = new lambda::Variable(*$1); }
 ;
 
 %%
 
-void yyerror(FILE* out, bool display_process, const char* s) {
+void yyerror(FILE* out, lambda::ReduceOptions& options, const char* s) {
   throw std::runtime_error(s);
 }
@@ -0,0 +1,119 @@
+#include "progress.h"
+#include "native.h"
+
+#include <csignal>
+#include <cstdio>
+
+namespace lambda {
+
+  // steps between two looks at the clock and the signal
+  static constexpr unsigned long long CHECK_INTERVAL = 256;
+
+  static volatile std::sig_atomic_t snapshot_requested = 0;
+
+  static void request_snapshot(int) {
+    snapshot_requested = 1;
+  }
+
+  void handle_progress_signal() {
+    std::signal(SIGUSR1, request_snapshot);
+  }
+
+  // closures and native operators count as one level
+  static auto depth(Expression* expression) -> unsigned long long {
+    if (auto root = dynamic_cast<Root*>(expression)) {
+      return depth(root->get_expression());
+    }
+    if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      return 1 + depth(abstraction->get_body());
+    }
+    if (auto application = dynamic_cast<Application*>(expression)) {
+      auto first = depth(application->get_first());
+      auto second = depth(application->get_second());
+      return 1 + (first > second ? first : second);
+    }
+    return 1;
+  }
+
+  // what the spine below the leading abstractions starts with: a variable,
+  // or a redex when it is an abstraction
+  static auto describe_head(Expression* expression) -> std::string {
+    if (auto root = dynamic_cast<Root*>(expression)) {
+      expression = root->get_expression();
+    }
+    unsigned binder_count = 0;
+    while (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      expression = abstraction->get_body();
+      binder_count++;
+    }
+    bool is_applied = false;
+    while (auto application = dynamic_cast<Application*>(expression)) {
+      expression = application->get_first();
+      is_applied = true;
+    }
+
+    std::string head;
+    if (auto variable = dynamic_cast<Variable*>(expression)) {
+      head = variable->get_literal();
+    }
+    else if (dynamic_cast<Abstraction*>(expression) != nullptr) {
+      head = "redex";
+    }
+    else if (auto numeral = dynamic_cast<Numeral*>(expression)) {
+      head = std::to_string(numeral->get_value());
+    }
+    else if (auto primitive = dynamic_cast<Primitive*>(expression)) {
+      head = std::string(primitive->get_native_operator()->literal) + " (native)";
+    }
+    else {
+      head = "closure";
+    }
+
+    if (!is_applied) { head += ", not applied"; }
+    if (binder_count > 0) {
+      head += " under " + std::to_string(binder_count) + " binders";
+    }
+    return head;
+  }
+
+  ProgressReporter::ProgressReporter(
+    unsigned long long seconds,
+    unsigned long long first_step
+  ): interval(std::chrono::seconds(seconds)),
+    start(std::chrono::steady_clock::now()),
+    last_report(start),
+    last_step(first_step) {}
+
+  bool ProgressReporter::is_due(unsigned long long step) {
+    if (step % CHECK_INTERVAL != 0) { return false; }
+    if (snapshot_requested) { return true; }
+    return interval.count() > 0
+      && std::chrono::steady_clock::now() - last_report >= interval;
+  }
+
+  void ProgressReporter::report(Expression* expression, unsigned long long step) {
+    snapshot_requested = 0;
+
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration<double>(now - last_report).count();
+    auto total = std::chrono::duration_cast<std::chrono::milliseconds>(now - start);
+    // over the steps since the last report
+    auto rate = elapsed > 0 ? (unsigned long long)((step - last_step) / elapsed) : 0;
+
+    fprintf(
+      stderr,
+      "progress:         step %llu, %llu steps/s, %llu live nodes, size %llu, depth %llu, head %s, %lldms\n",
+      step,
+      rate,
+      Expression::get_live_count(),
+      expression->get_size(),
+      depth(expression),
+      describe_head(expression).c_str(),
+      (long long)total.count()
+    );
+
+    last_report = now;
+    last_step = step;
+  }
+
+}
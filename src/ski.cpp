@@ -0,0 +1,408 @@
+#include "ski.h"
+
+#include <stdexcept>
+#include <climits>
+
+namespace lambda {
+
+  static bool is_number(const std::string& s) {
+    for (auto ch: s) {
+      if (ch < '0' || ch > '9') { return false; }
+    }
+    return !s.empty();
+  }
+
+  static auto index_to_string(unsigned index) -> std::string {
+    constexpr unsigned LETTER_N = 26;
+    auto result = std::string("");
+
+    for (; index >= LETTER_N; index /= LETTER_N) {
+      result += 'a' + index % LETTER_N;
+    }
+    result += 'a' + index % LETTER_N;
+
+    return result;
+  }
+
+  // arguments each combinator takes, by Combinator
+  static constexpr unsigned ARITIES[] = { 1, 2, 3, 3, 3, 4, 4, 4, 1 };
+  static constexpr unsigned MAX_ARITY = 4;
+  static constexpr size_t COMBINATOR_COUNT = sizeof(ARITIES) / sizeof(*ARITIES);
+
+
+  auto SkiBackend::make_cell(Kind kind, uint32_t first, uint32_t second) -> uint32_t {
+    cells.push_back({ kind, Combinator::I, first, second });
+    return cells.size() - 1;
+  }
+
+  auto SkiBackend::make_application(uint32_t first, uint32_t second) -> uint32_t {
+    return make_cell(Kind::Application, first, second);
+  }
+
+  auto SkiBackend::make_combinator(Combinator combinator) -> uint32_t {
+    auto& cell = combinators[(size_t)combinator];
+    if (cell == UINT32_MAX) {
+      auto new_cell = make_cell(Kind::Combinator, 0, 0);
+      cells[new_cell].combinator = combinator;
+      cell = new_cell;
+    }
+    return cell;
+  }
+
+  auto SkiBackend::name_index(const std::string& name) -> uint32_t {
+    auto [it, inserted] = name_indices.emplace(name, names.size());
+    if (inserted) { names.push_back(name); }
+    return it->second;
+  }
+
+  auto SkiBackend::follow(uint32_t cell) -> uint32_t {
+    while (cells[cell].kind == Kind::Indirection) { cell = cells[cell].first; }
+    return cell;
+  }
+
+
+  auto SkiBackend::compile(
+    Expression* expression,
+    std::multiset<std::string>& bound_variables
+  ) -> uint32_t {
+    if (auto root = dynamic_cast<Root*>(expression)) {
+      return compile(root->get_expression(), bound_variables);
+    }
+
+    if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      auto& literal = abstraction->get_binder().get_literal();
+      auto it = bound_variables.insert(literal);
+      auto body = compile(abstraction->get_body(), bound_variables);
+      bound_variables.erase(it);
+      return abstract(name_index(literal), body);
+    }
+
+    if (auto application = dynamic_cast<Application*>(expression)) {
+      auto first = compile(application->get_first(), bound_variables);
+      auto second = compile(application->get_second(), bound_variables);
+      return make_application(first, second);
+    }
+
+    if (auto numeral = dynamic_cast<Numeral*>(expression)) {
+      return compile_numeral(numeral->get_value());
+    }
+
+    if (auto primitive = dynamic_cast<Primitive*>(expression)) {
+      auto expanded = primitive->expand();
+      auto result = compile(expanded, bound_variables);
+      expanded->delete_instance();
+      return result;
+    }
+
+    auto& literal = static_cast<Variable*>(expression)->get_literal();
+    if (bound_variables.count(literal) > 0) {
+      return make_cell(Kind::Variable, name_index(literal), 0);
+    }
+    if (is_number(literal)) {
+      unsigned long long value = 0;
+      for (auto ch: literal) {
+        value = value * 10 + (ch - '0');
+        // left to the tree, which reports it
+        if (value > UINT_MAX) {
+          throw std::runtime_error("the numeral " + literal + " cannot be compiled");
+        }
+      }
+      return compile_numeral(value);
+    }
+    if (symbol_table->count(literal) > 0) {
+      return make_cell(Kind::Symbol, name_index(literal), 0);
+    }
+    free_literals.insert(literal);
+    return make_cell(Kind::Free, name_index(literal), 0);
+  }
+
+  // `S B` is the successor of Church numerals and `K I` is zero
+  auto SkiBackend::compile_numeral(unsigned value) -> uint32_t {
+    auto result = make_application(
+      make_combinator(Combinator::K), make_combinator(Combinator::I)
+    );
+    if (value == 0) { return result; }
+
+    auto successor = make_application(
+      make_combinator(Combinator::S), make_combinator(Combinator::B)
+    );
+    for (unsigned i = 0; i < value; i++) {
+      result = make_application(successor, result);
+    }
+    return result;
+  }
+
+  // a symbol that refers to itself is compiled to `Y ([f] M)`, which ties
+  // the knot when reduced
+  auto SkiBackend::compile_symbol(uint32_t name) -> uint32_t {
+    auto it = definitions.find(name);
+    if (it != definitions.end()) { return it->second; }
+
+    // `names` grows while compiling
+    auto literal = names[name];
+    auto definition = symbol_table->at(literal);
+
+    std::multiset<std::string> bound_variables { literal };
+    auto body = compile(definition, bound_variables);
+    auto result = contains(body, name)
+      ? make_application(make_combinator(Combinator::Y), abstract(name, body))
+      : body;
+
+    definitions[name] = result;
+    return result;
+  }
+
+  bool SkiBackend::contains(uint32_t cell, uint32_t name) {
+    switch (cells[cell].kind) {
+      case Kind::Variable:
+        return cells[cell].first == name;
+      case Kind::Application:
+        return contains(cells[cell].first, name) || contains(cells[cell].second, name);
+      default:
+        return false;
+    }
+  }
+
+  bool SkiBackend::is_composition(uint32_t cell, uint32_t& p, uint32_t& q) {
+    if (cells[cell].kind != Kind::Application) { return false; }
+    auto inner = cells[cell].first;
+    if (cells[inner].kind != Kind::Application) { return false; }
+    auto head = cells[inner].first;
+    if (
+      cells[head].kind != Kind::Combinator
+      || cells[head].combinator != Combinator::B
+    ) {
+      return false;
+    }
+    p = cells[inner].second;
+    q = cells[cell].second;
+    return true;
+  }
+
+  // Turner's rules. `[x] M x` is not reduced to `M`, the normal form of
+  // `\x. f x` is not the one of `f`
+  auto SkiBackend::abstract(uint32_t name, uint32_t cell) -> uint32_t {
+    if (!contains(cell, name)) {
+      return make_application(make_combinator(Combinator::K), cell);
+    }
+    if (cells[cell].kind == Kind::Variable) {
+      return make_combinator(Combinator::I);
+    }
+
+    auto first = cells[cell].first;
+    auto second = cells[cell].second;
+    uint32_t p, q;
+
+    // S (K p) (B q r) = B* p q r, S (K p) q = B p q
+    if (!contains(first, name)) {
+      auto abstracted = abstract(name, second);
+      if (is_composition(abstracted, p, q)) {
+        return make_application(make_application(make_application(
+          make_combinator(Combinator::BStar), first), p), q);
+      }
+      return make_application(
+        make_application(make_combinator(Combinator::B), first), abstracted
+      );
+    }
+
+    auto abstracted = abstract(name, first);
+
+    // S (B p q) (K r) = C' p q r, S p (K q) = C p q
+    if (!contains(second, name)) {
+      if (is_composition(abstracted, p, q)) {
+        return make_application(make_application(make_application(
+          make_combinator(Combinator::CPrime), p), q), second);
+      }
+      return make_application(
+        make_application(make_combinator(Combinator::C), abstracted), second
+      );
+    }
+
+    // S (B p q) r = S' p q r
+    auto abstracted_second = abstract(name, second);
+    if (is_composition(abstracted, p, q)) {
+      return make_application(make_application(make_application(
+        make_combinator(Combinator::SPrime), p), q), abstracted_second);
+    }
+    return make_application(
+      make_application(make_combinator(Combinator::S), abstracted),
+      abstracted_second
+    );
+  }
+
+
+  void SkiBackend::reduce(uint32_t cell, std::vector<uint32_t>& spine) {
+    spine.clear();
+    auto current = follow(cell);
+
+    for (;;) {
+      switch (cells[current].kind) {
+        case Kind::Application: {
+          // indirections behind the function are skipped from now on
+          auto first = follow(cells[current].first);
+          cells[current].first = first;
+          spine.push_back(current);
+          current = first;
+          continue;
+        }
+
+        case Kind::Symbol: {
+          auto definition = compile_symbol(cells[current].first);
+          cells[current].kind = Kind::Indirection;
+          cells[current].first = definition;
+          unfold_count++;
+          current = follow(current);
+          continue;
+        }
+
+        case Kind::Combinator: {
+          auto combinator = cells[current].combinator;
+          auto arity = ARITIES[(size_t)combinator];
+          if (spine.size() < arity) { return; }
+
+          uint32_t arguments[MAX_ARITY];
+          for (unsigned i = 0; i < arity; i++) {
+            arguments[i] = cells[spine[spine.size() - 1 - i]].second;
+          }
+          auto redex = spine[spine.size() - arity];
+          spine.resize(spine.size() - arity);
+
+          rewrite(redex, combinator, arguments);
+          combinator_count++;
+          current = follow(redex);
+          continue;
+        }
+
+        case Kind::Free:
+          return;
+
+        default:
+          throw std::runtime_error("the combinator graph cannot be reduced");
+      }
+    }
+  }
+
+  // the redex is overwritten by its result, so that every cell pointing to
+  // it sees the result
+  void SkiBackend::rewrite(
+    uint32_t redex,
+    Combinator combinator,
+    const uint32_t* arguments
+  ) {
+    uint32_t first = 0, second = 0;
+
+    switch (combinator) {
+      case Combinator::I:
+      case Combinator::K:
+        cells[redex].kind = Kind::Indirection;
+        cells[redex].first = arguments[0];
+        return;
+
+      case Combinator::S:
+        first = make_application(arguments[0], arguments[2]);
+        second = make_application(arguments[1], arguments[2]);
+        break;
+
+      case Combinator::B:
+        first = arguments[0];
+        second = make_application(arguments[1], arguments[2]);
+        break;
+
+      case Combinator::C:
+        first = make_application(arguments[0], arguments[2]);
+        second = arguments[1];
+        break;
+
+      case Combinator::SPrime:
+        first = make_application(
+          arguments[0], make_application(arguments[1], arguments[3])
+        );
+        second = make_application(arguments[2], arguments[3]);
+        break;
+
+      case Combinator::BStar:
+        first = arguments[0];
+        second = make_application(
+          arguments[1], make_application(arguments[2], arguments[3])
+        );
+        break;
+
+      case Combinator::CPrime:
+        first = make_application(
+          arguments[0], make_application(arguments[1], arguments[3])
+        );
+        second = arguments[2];
+        break;
+
+      case Combinator::Y:
+        first = arguments[0];
+        second = redex;
+        break;
+    }
+
+    cells[redex].kind = Kind::Application;
+    cells[redex].first = first;
+    cells[redex].second = second;
+  }
+
+  auto SkiBackend::read_back(
+    uint32_t cell,
+    std::multiset<std::string>& bound_variables
+  ) -> Expression* {
+    std::vector<uint32_t> spine;
+    reduce(cell, spine);
+
+    auto head = follow(spine.empty() ? cell : cells[spine.back()].first);
+    if (cells[head].kind == Kind::Free) {
+      Expression* result = new Variable(names[cells[head].first]);
+      for (auto i = spine.size(); i-- > 0;) {
+        auto argument = cells[spine[i]].second;
+        result = new Application(result, read_back(argument, bound_variables));
+      }
+      return result;
+    }
+
+    // a combinator short of arguments is a function, its body is what it
+    // gives for a fresh variable
+    auto literal = std::string("");
+    for (unsigned i = 0;
+      literal.empty()
+        || bound_variables.count(literal) > 0
+        || free_literals.count(literal) > 0;
+      i++
+    ) {
+      literal = index_to_string(i);
+    }
+
+    auto variable = make_cell(Kind::Free, name_index(literal), 0);
+    auto application = make_application(cell, variable);
+
+    auto it = bound_variables.insert(literal);
+    auto body = read_back(application, bound_variables);
+    bound_variables.erase(it);
+    return new Abstraction(Variable(literal), body);
+  }
+
+  auto SkiBackend::normalize(
+    Expression* expression,
+    std::map<std::string, Expression*>& symbol_table,
+    unsigned long long& step
+  ) -> Expression* {
+    this->symbol_table = &symbol_table;
+    combinators.assign(COMBINATOR_COUNT, UINT32_MAX);
+
+    std::multiset<std::string> bound_variables;
+    auto cell = compile(expression, bound_variables);
+    auto result = read_back(cell, bound_variables);
+
+    step = combinator_count + unfold_count;
+    return new Root(result);
+  }
+
+  auto SkiBackend::get_statistics() -> std::string {
+    return std::to_string(combinator_count) + " combinator, "
+      + std::to_string(unfold_count) + " unfold, "
+      + std::to_string(cells.size()) + " cells";
+  }
+
+}
@@ -0,0 +1,303 @@
+#include "strategy.h"
+
+#include <stdexcept>
+
+namespace lambda {
+
+  using SymbolTable = std::map<std::string, Expression*>;
+  using BoundVariables = std::multiset<std::string>;
+
+  // reduction order given by `{}` and `$`, see Application::reduce
+  class AnnotatedStrategy: public Strategy {
+  public:
+    AnnotatedStrategy(ExplicitSubstitution* substitution)
+      : substitution(substitution) {}
+
+    auto step(
+      Expression*& expression,
+      SymbolTable& symbol_table
+    ) -> ReduceType override {
+      BoundVariables bound_variables;
+      ReduceType reduce_type;
+      std::tie(expression, reduce_type) = expression->reduce(
+        symbol_table,
+        bound_variables,
+        substitution
+      );
+      return reduce_type;
+    }
+
+  private:
+    ExplicitSubstitution* substitution;
+  };
+
+  // the remaining strategies ignore `{}` and `$`, they search the redex from
+  // the root on every step and rewrite the tree in place. the ones reducing
+  // to normal form mark the subterms they found no redex in, which later
+  // searches skip until a rewrite replaces them
+
+  static auto delta_reduce(
+    Expression*& expression,
+    SymbolTable& symbol_table,
+    BoundVariables& bound_variables
+  ) -> ReduceType {
+    auto variable = dynamic_cast<Variable*>(expression);
+    if (variable == nullptr) { return ReduceType::Null; }
+
+    ReduceType reduce_type;
+    std::tie(expression, reduce_type) = variable->reduce(
+      symbol_table,
+      bound_variables,
+      nullptr
+    );
+    return reduce_type;
+  }
+
+  static auto beta_reduce(
+    Expression*& expression,
+    BoundVariables& bound_variables
+  ) -> ReduceType {
+    auto application = dynamic_cast<Application*>(expression);
+    if (application == nullptr) { return ReduceType::Null; }
+
+    ReduceType reduce_type;
+    std::tie(expression, reduce_type) = application->contract(bound_variables);
+    return reduce_type;
+  }
+
+  // `expression` is the parent of what a step rewrote, if it rewrote
+  // anything, which is done through a reference to the child
+  static auto rewritten(Expression* expression, ReduceType reduce_type) -> ReduceType {
+    if ((bool)reduce_type) { expression->invalidate_hash(); }
+    return reduce_type;
+  }
+
+  // step `expression` with `function` under the binder of an abstraction
+  template <typename Function>
+  static auto under_binder(
+    Abstraction* abstraction,
+    BoundVariables& bound_variables,
+    Function function
+  ) -> ReduceType {
+    auto it = bound_variables.emplace(abstraction->get_binder().get_literal());
+    auto reduce_type = function(abstraction->get_body());
+    bound_variables.erase(it);
+    return rewritten(abstraction, reduce_type);
+  }
+
+  // nothing to reduce below `expression` when `reduce_type` is Null
+  static auto searched(Expression* expression, ReduceType reduce_type) -> ReduceType {
+    if (!(bool)reduce_type) { expression->set_normal_form(); }
+    return reduce_type;
+  }
+
+  // `\x. M`, or a numeral standing for one
+  static bool is_abstraction(Expression* expression) {
+    return dynamic_cast<Abstraction*>(expression) != nullptr
+      || dynamic_cast<Numeral*>(expression) != nullptr;
+  }
+
+  static auto root_expression(Expression*& expression) -> Expression*& {
+    if (auto root = dynamic_cast<Root*>(expression)) {
+      return root->get_expression();
+    }
+    return expression;
+  }
+
+  class SearchingStrategy: public Strategy {
+  public:
+    auto step(
+      Expression*& expression,
+      SymbolTable& symbol_table
+    ) -> ReduceType override {
+      BoundVariables bound_variables;
+      return rewritten(
+        expression,
+        step(root_expression(expression), symbol_table, bound_variables)
+      );
+    }
+
+  protected:
+    virtual auto step(
+      Expression*& expression,
+      SymbolTable& symbol_table,
+      BoundVariables& bound_variables
+    ) -> ReduceType = 0;
+  };
+
+  // leftmost outermost redex first, to normal form
+  class NormalOrderStrategy: public SearchingStrategy {
+  protected:
+    auto step(
+      Expression*& expression,
+      SymbolTable& symbol_table,
+      BoundVariables& bound_variables
+    ) -> ReduceType override {
+      if (expression->is_in_normal_form()) { return ReduceType::Null; }
+
+      if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+        return searched(
+          abstraction,
+          under_binder(abstraction, bound_variables, [&](Expression*& body) {
+            return step(body, symbol_table, bound_variables);
+          })
+        );
+      }
+
+      auto application = dynamic_cast<Application*>(expression);
+      if (application == nullptr) {
+        return delta_reduce(expression, symbol_table, bound_variables);
+      }
+
+      auto reduce_type = beta_reduce(expression, bound_variables);
+      if ((bool)reduce_type) { return reduce_type; }
+
+      reduce_type = step(application->get_first(), symbol_table, bound_variables);
+      if ((bool)reduce_type) { return rewritten(application, reduce_type); }
+
+      return searched(
+        application,
+        rewritten(
+          application, step(application->get_second(), symbol_table, bound_variables)
+        )
+      );
+    }
+  };
+
+  // leftmost innermost redex first, to normal form
+  class ApplicativeOrderStrategy: public SearchingStrategy {
+  protected:
+    auto step(
+      Expression*& expression,
+      SymbolTable& symbol_table,
+      BoundVariables& bound_variables
+    ) -> ReduceType override {
+      if (expression->is_in_normal_form()) { return ReduceType::Null; }
+
+      if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+        return searched(
+          abstraction,
+          under_binder(abstraction, bound_variables, [&](Expression*& body) {
+            return step(body, symbol_table, bound_variables);
+          })
+        );
+      }
+
+      auto application = dynamic_cast<Application*>(expression);
+      if (application == nullptr) {
+        return delta_reduce(expression, symbol_table, bound_variables);
+      }
+
+      auto reduce_type = step(application->get_first(), symbol_table, bound_variables);
+      if ((bool)reduce_type) { return rewritten(application, reduce_type); }
+
+      reduce_type = step(application->get_second(), symbol_table, bound_variables);
+      if ((bool)reduce_type) { return rewritten(application, reduce_type); }
+
+      return searched(application, beta_reduce(expression, bound_variables));
+    }
+  };
+
+  // arguments are reduced to values before they are substituted, never under
+  // an abstraction, to weak head normal form
+  class CallByValueStrategy: public SearchingStrategy {
+  protected:
+    auto step(
+      Expression*& expression,
+      SymbolTable& symbol_table,
+      BoundVariables& bound_variables
+    ) -> ReduceType override {
+      if (is_abstraction(expression)) {
+        return ReduceType::Null;
+      }
+
+      auto application = dynamic_cast<Application*>(expression);
+      if (application == nullptr) {
+        return delta_reduce(expression, symbol_table, bound_variables);
+      }
+
+      auto reduce_type = step(application->get_first(), symbol_table, bound_variables);
+      if ((bool)reduce_type) { return rewritten(application, reduce_type); }
+
+      // `x M` with a free `x` is already in weak head normal form
+      if (!is_abstraction(application->get_first())) {
+        return ReduceType::Null;
+      }
+
+      reduce_type = step(application->get_second(), symbol_table, bound_variables);
+      if ((bool)reduce_type) { return rewritten(application, reduce_type); }
+
+      return beta_reduce(expression, bound_variables);
+    }
+  };
+
+  // only the head is reduced, to `\x1...\xn. x M1 ... Mk`
+  class HeadNormalFormStrategy: public SearchingStrategy {
+  protected:
+    auto step(
+      Expression*& expression,
+      SymbolTable& symbol_table,
+      BoundVariables& bound_variables
+    ) -> ReduceType override {
+      if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+        return under_binder(abstraction, bound_variables, [&](Expression*& body) {
+          return step(body, symbol_table, bound_variables);
+        });
+      }
+
+      auto application = dynamic_cast<Application*>(expression);
+      if (application == nullptr) {
+        return delta_reduce(expression, symbol_table, bound_variables);
+      }
+
+      auto reduce_type = beta_reduce(expression, bound_variables);
+      if ((bool)reduce_type) { return reduce_type; }
+
+      return rewritten(
+        application, step(application->get_first(), symbol_table, bound_variables)
+      );
+    }
+  };
+
+  static const std::map<std::string, StrategyType> STRATEGY_NAMES = {
+    { "annotated", StrategyType::Annotated },
+    { "normal", StrategyType::NormalOrder },
+    { "applicative", StrategyType::ApplicativeOrder },
+    { "value", StrategyType::CallByValue },
+    { "head", StrategyType::HeadNormalForm }
+  };
+
+  auto strategy_from_name(const std::string& name) -> StrategyType {
+    auto it = STRATEGY_NAMES.find(name);
+    if (it == STRATEGY_NAMES.end()) {
+      throw std::runtime_error("unknown strategy " + name);
+    }
+    return it->second;
+  }
+
+  auto strategy_name(StrategyType strategy_type) -> std::string {
+    for (auto& [name, type]: STRATEGY_NAMES) {
+      if (type == strategy_type) { return name; }
+    }
+    return "";
+  }
+
+  auto make_strategy(
+    StrategyType strategy_type,
+    ExplicitSubstitution* substitution
+  ) -> std::unique_ptr<Strategy> {
+    switch (strategy_type) {
+      case StrategyType::NormalOrder:
+        return std::make_unique<NormalOrderStrategy>();
+      case StrategyType::ApplicativeOrder:
+        return std::make_unique<ApplicativeOrderStrategy>();
+      case StrategyType::CallByValue:
+        return std::make_unique<CallByValueStrategy>();
+      case StrategyType::HeadNormalForm:
+        return std::make_unique<HeadNormalFormStrategy>();
+      default:
+        return std::make_unique<AnnotatedStrategy>(substitution);
+    }
+  }
+
+}
@@ -0,0 +1,121 @@
+#include "stream.h"
+
+namespace lambda {
+
+  // the head of an application is a variable in normal form, thus it is never
+  // contracted and stays an application
+  static bool is_stuck(Application* application) {
+    auto head = application->get_first();
+    while (auto spine = dynamic_cast<Application*>(head)) {
+      head = spine->get_first();
+    }
+    return dynamic_cast<Variable*>(head) != nullptr && head->is_in_normal_form();
+  }
+
+  // whether `expression` keeps its kind, which decides how it is parenthesized
+  static bool is_shape_final(Expression* expression) {
+    if (expression->is_in_normal_form()) { return true; }
+    if (dynamic_cast<Abstraction*>(expression) != nullptr) { return true; }
+    if (dynamic_cast<Numeral*>(expression) != nullptr) { return true; }
+
+    auto application = dynamic_cast<Application*>(expression);
+    return application != nullptr && is_stuck(application);
+  }
+
+  StreamPrinter::StreamPrinter(FILE* out): out(out), is_started(false), is_finishing(false) {}
+
+  void StreamPrinter::update(Expression* expression) {
+    resume(expression);
+    fflush(out);
+  }
+
+  void StreamPrinter::finish(Expression* expression) {
+    is_finishing = true;
+    resume(expression);
+  }
+
+  // prints exactly what `to_string` prints, piece by piece
+  void StreamPrinter::resume(Expression* root) {
+    if (!is_started) {
+      frames.push_back({ nullptr, 0, false });
+      is_started = true;
+    }
+
+    while (!frames.empty()) {
+      auto& frame = frames.back();
+
+      if (frame.expression == nullptr) {
+        if (frame.stage == 1) { frames.pop_back(); continue; }
+        while (auto wrapper = dynamic_cast<Root*>(root)) {
+          root = wrapper->get_expression();
+        }
+        frame.stage = 1;
+        if (!enter(root)) { frame.stage = 0; return; }
+        continue;
+      }
+
+      if (auto abstraction = dynamic_cast<Abstraction*>(frame.expression)) {
+        auto body = abstraction->get_body();
+        if (frame.stage == 0) {
+          fprintf(out, "\\%s.", abstraction->get_binder().to_string().c_str());
+          frame.stage = 1;
+        }
+        else if (frame.stage == 1) {
+          if (!is_finishing && !is_shape_final(body)) { return; }
+          if (body->get_priority() > Priority::Abstraction) { fputc(' ', out); }
+          frame.stage = 2;
+          enter(body);
+        }
+        else { frames.pop_back(); }
+        continue;
+      }
+
+      auto application = static_cast<Application*>(frame.expression);
+      if (frame.stage == 0) {
+        auto first = application->get_first();
+        frame.is_parenthesized = first->get_priority() < application->get_priority();
+        if (frame.is_parenthesized) { fputc('(', out); }
+        frame.stage = 1;
+        enter(first);
+      }
+      else if (frame.stage == 1) {
+        fprintf(out, frame.is_parenthesized ? ") " : " ");
+        frame.stage = 2;
+      }
+      else if (frame.stage == 2) {
+        auto second = application->get_second();
+        if (!is_finishing && !is_shape_final(second)) { return; }
+        frame.is_parenthesized = second->get_priority() <= application->get_priority();
+        if (frame.is_parenthesized) { fputc('(', out); }
+        frame.stage = 3;
+        enter(second);
+      }
+      else {
+        if (frame.is_parenthesized) { fputc(')', out); }
+        frames.pop_back();
+      }
+    }
+  }
+
+  bool StreamPrinter::enter(Expression* child) {
+    if (
+      is_finishing
+      || child->is_in_normal_form()
+      || dynamic_cast<Numeral*>(child) != nullptr
+    ) {
+      fprintf(out, "%s", child->to_string().c_str());
+      return true;
+    }
+
+    if (dynamic_cast<Abstraction*>(child) != nullptr) {
+      frames.push_back({ child, 0, false });
+      return true;
+    }
+
+    auto application = dynamic_cast<Application*>(child);
+    if (application == nullptr || !is_stuck(application)) { return false; }
+    frames.push_back({ child, 0, false });
+    return true;
+  }
+
+}
@@ -0,0 +1,370 @@
+#include "strictness.h"
+
+#include <cstdint>
+
+namespace lambda {
+
+  using Signature = StrictnessAnalyzer::Signature;
+
+  // `f M1 ... Mk`, arguments in order
+  static auto flatten(
+    Application* application,
+    std::vector<Expression*>& arguments
+  ) -> Expression* {
+    Expression* head = application;
+    while (auto spine = dynamic_cast<Application*>(head)) {
+      arguments.insert(arguments.begin(), spine->get_second());
+      head = spine->get_first();
+    }
+    return head;
+  }
+
+  // `\x1...\xn. M`, body returned
+  static auto collect_parameters(
+    Expression* expression,
+    std::vector<std::string>& parameters
+  ) -> Expression* {
+    while (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      parameters.push_back(abstraction->get_binder().get_literal());
+      expression = abstraction->get_body();
+    }
+    return expression;
+  }
+
+  static auto count_occurrences(
+    Expression* expression,
+    const std::string& literal
+  ) -> unsigned {
+    if (auto variable = dynamic_cast<Variable*>(expression)) {
+      return variable->get_literal() == literal ? 1 : 0;
+    }
+    if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      if (abstraction->get_binder().get_literal() == literal) { return 0; }
+      return count_occurrences(abstraction->get_body(), literal);
+    }
+    if (auto application = dynamic_cast<Application*>(expression)) {
+      return count_occurrences(application->get_first(), literal)
+        + count_occurrences(application->get_second(), literal);
+    }
+    return 0;
+  }
+
+  // a parameter shadowed by a later one with the same name is never used
+  static auto to_signature(
+    const std::vector<std::string>& parameters,
+    Expression* body,
+    const std::set<std::string>& demand
+  ) -> Signature {
+    Signature signature(parameters.size());
+    std::set<std::string> shadowing;
+    for (auto i = parameters.size(); i-- > 0;) {
+      auto is_shadowed = shadowing.count(parameters[i]) > 0;
+      signature[i].is_strict = !is_shadowed && demand.count(parameters[i]) > 0;
+      signature[i].is_shared = !is_shadowed
+        && count_occurrences(body, parameters[i]) > 1;
+      shadowing.insert(parameters[i]);
+    }
+    return signature;
+  }
+
+  static bool is_same_strictness(const Signature& a, const Signature& b) {
+    for (size_t i = 0; i < a.size(); i++) {
+      if (a[i].is_strict != b[i].is_strict) { return false; }
+    }
+    return true;
+  }
+
+  // only pending computations are worth marking. `{x}` on a parameter would
+  // force whatever is substituted for it, which is already marked where
+  // that is passed when it is strict there
+  static bool is_markable(Expression* argument) {
+    return argument->get_computational_priority() == ComputationalPriority::Neutral
+      && dynamic_cast<Application*>(argument) != nullptr;
+  }
+
+  StrictnessAnalyzer::StrictnessAnalyzer(Reducer& reducer): reducer(reducer) {}
+
+  auto StrictnessAnalyzer::annotate(
+    const std::string& literal,
+    Expression* expression
+  ) -> std::string {
+    if (!literal.empty()) {
+      signatures.erase(literal);
+      predicate_arities.erase(literal);
+      signatures[literal] = infer_signature(literal, expression);
+    }
+
+    std::string report;
+    BoundVariables bound_variables;
+    mark(expression, bound_variables, report);
+    return report;
+  }
+
+  auto StrictnessAnalyzer::signature_of(
+    const std::string& literal
+  ) -> const Signature* {
+    auto it = signatures.find(literal);
+    if (it != signatures.end()) { return &it->second; }
+    if (analyzing.count(literal) > 0) { return nullptr; }
+
+    // defined in an image, or before the analysis was enabled
+    auto definition = reducer.find_symbol(literal);
+    if (definition == nullptr) { return nullptr; }
+
+    analyzing.insert(literal);
+    auto signature = infer_signature(literal, definition);
+    analyzing.erase(literal);
+    inferred.push_back(literal);
+    return &(signatures[literal] = signature);
+  }
+
+  auto StrictnessAnalyzer::predicate_arity(const std::string& literal) -> size_t {
+    auto it = predicate_arities.find(literal);
+    if (it != predicate_arities.end()) { return it->second; }
+    if (literal == "T" || literal == "F") { return predicate_arities[literal] = 0; }
+    if (literal == "0n?") { return predicate_arities[literal] = 1; }
+
+    auto definition = reducer.find_symbol(literal);
+    if (definition == nullptr) { return SIZE_MAX; }
+
+    // recursive calls are not taken as giving `T` or `F`
+    predicate_arities[literal] = SIZE_MAX;
+    std::vector<std::string> parameters;
+    auto body = collect_parameters(definition, parameters);
+    BoundVariables bound_variables(parameters.begin(), parameters.end());
+    return predicate_arities[literal] = is_boolean(body, bound_variables)
+      ? parameters.size()
+      : SIZE_MAX;
+  }
+
+  bool StrictnessAnalyzer::is_boolean(
+    Expression* expression,
+    BoundVariables& bound_variables
+  ) {
+    if (auto root = dynamic_cast<Root*>(expression)) {
+      return is_boolean(root->get_expression(), bound_variables);
+    }
+
+    std::vector<Expression*> arguments;
+    auto head = expression;
+    if (auto application = dynamic_cast<Application*>(expression)) {
+      head = flatten(application, arguments);
+    }
+
+    if (auto variable = dynamic_cast<Variable*>(head)) {
+      if (bound_variables.count(variable->get_literal()) > 0) { return false; }
+      return predicate_arity(variable->get_literal()) == arguments.size();
+    }
+
+    // `(\m.\n. M) {m} {n}`, as `=n` and `%n` of `nature.lambda` are
+    auto abstraction = dynamic_cast<Abstraction*>(head);
+    if (abstraction == nullptr) { return false; }
+    std::vector<std::string> parameters;
+    auto body = collect_parameters(abstraction, parameters);
+    if (parameters.size() != arguments.size()) { return false; }
+
+    std::vector<BoundVariables::iterator> its;
+    for (auto& parameter: parameters) {
+      its.push_back(bound_variables.emplace(parameter));
+    }
+    auto result = is_boolean(body, bound_variables);
+    for (auto it: its) { bound_variables.erase(it); }
+    return result;
+  }
+
+  // greatest fixed point, recursive calls start out strict in everything
+  auto StrictnessAnalyzer::infer_signature(
+    const std::string& literal,
+    Expression* definition
+  ) -> Signature {
+    std::vector<std::string> parameters;
+    auto body = collect_parameters(definition, parameters);
+    if (parameters.empty()) { return {}; }
+
+    signatures[literal] = Signature(parameters.size(), { true, false });
+    auto first_inferred = inferred.size();
+    for (;;) {
+      BoundVariables bound_variables(parameters.begin(), parameters.end());
+      auto signature = to_signature(
+        parameters, body, demanded(body, bound_variables)
+      );
+      if (is_same_strictness(signature, signatures[literal])) { return signature; }
+      signatures[literal] = signature;
+
+      // inferred from calls to `literal` taken as stricter than they are,
+      // as mutually recursive definitions are
+      for (auto i = first_inferred; i < inferred.size(); i++) {
+        if (inferred[i] != literal) { signatures.erase(inferred[i]); }
+      }
+      inferred.resize(first_inferred);
+    }
+  }
+
+  auto StrictnessAnalyzer::abstraction_signature(
+    Expression* abstraction,
+    BoundVariables& bound_variables
+  ) -> Signature {
+    std::vector<std::string> parameters;
+    auto body = collect_parameters(abstraction, parameters);
+
+    std::vector<BoundVariables::iterator> its;
+    for (auto& parameter: parameters) {
+      its.push_back(bound_variables.emplace(parameter));
+    }
+    auto demand = demanded(body, bound_variables);
+    for (auto it: its) { bound_variables.erase(it); }
+
+    return to_signature(parameters, body, demand);
+  }
+
+  auto StrictnessAnalyzer::demanded(
+    Expression* expression,
+    BoundVariables& bound_variables
+  ) -> Demand {
+    if (auto root = dynamic_cast<Root*>(expression)) {
+      return demanded(root->get_expression(), bound_variables);
+    }
+
+    if (auto variable = dynamic_cast<Variable*>(expression)) {
+      if (bound_variables.count(variable->get_literal()) == 0) { return {}; }
+      return { variable->get_literal() };
+    }
+
+    auto application = dynamic_cast<Application*>(expression);
+    if (application == nullptr) { return {}; }
+
+    // `{c} $a $b` with `c` giving `T` or `F`, only one of the branches is
+    // taken
+    auto inner = dynamic_cast<Application*>(application->get_first());
+    if (
+      inner != nullptr
+      && application->get_second()->is_lazy()
+      && inner->get_second()->is_lazy()
+      && is_boolean(inner->get_first(), bound_variables)
+    ) {
+      auto demand = demanded(inner->get_first(), bound_variables);
+      auto taken = demanded(inner->get_second(), bound_variables);
+      for (auto& literal: demanded(application->get_second(), bound_variables)) {
+        if (taken.count(literal) > 0) { demand.insert(literal); }
+      }
+      return demand;
+    }
+
+    std::vector<Expression*> arguments;
+    auto head = flatten(application, arguments);
+
+    Demand demand;
+    // reduced before the application they are passed to is contracted
+    for (auto argument: arguments) {
+      auto priority = argument->get_computational_priority();
+      if (
+        priority == ComputationalPriority::Eager
+        || priority == ComputationalPriority::HeadEager
+      ) {
+        demand.merge(demanded(argument, bound_variables));
+      }
+    }
+
+    Signature signature;
+    if (auto variable = dynamic_cast<Variable*>(head)) {
+      if (bound_variables.count(variable->get_literal()) > 0) {
+        demand.insert(variable->get_literal());
+        return demand;
+      }
+      if (auto known = signature_of(variable->get_literal())) {
+        signature = *known;
+      }
+    }
+    else if (auto abstraction = dynamic_cast<Abstraction*>(head)) {
+      std::vector<std::string> parameters;
+      auto body = collect_parameters(abstraction, parameters);
+      signature = abstraction_signature(abstraction, bound_variables);
+
+      // partially applied, the result is an abstraction already
+      if (arguments.size() < parameters.size()) { return demand; }
+
+      std::vector<BoundVariables::iterator> its;
+      for (auto& parameter: parameters) {
+        its.push_back(bound_variables.emplace(parameter));
+      }
+      auto body_demand = demanded(body, bound_variables);
+      for (auto it: its) { bound_variables.erase(it); }
+
+      for (auto& literal: body_demand) {
+        auto is_parameter = false;
+        for (auto& parameter: parameters) {
+          if (parameter == literal) { is_parameter = true; }
+        }
+        if (!is_parameter) { demand.insert(literal); }
+      }
+    }
+
+    if (signature.empty() || arguments.size() < signature.size()) {
+      return demand;
+    }
+    for (size_t i = 0; i < signature.size(); i++) {
+      if (signature[i].is_strict) {
+        demand.merge(demanded(arguments[i], bound_variables));
+      }
+    }
+    return demand;
+  }
+
+  void StrictnessAnalyzer::mark(
+    Expression* expression,
+    BoundVariables& bound_variables,
+    std::string& report
+  ) {
+    if (auto root = dynamic_cast<Root*>(expression)) {
+      mark(root->get_expression(), bound_variables, report);
+      return;
+    }
+
+    if (auto abstraction = dynamic_cast<Abstraction*>(expression)) {
+      auto it = bound_variables.emplace(abstraction->get_binder().get_literal());
+      mark(abstraction->get_body(), bound_variables, report);
+      bound_variables.erase(it);
+      return;
+    }
+
+    auto application = dynamic_cast<Application*>(expression);
+    if (application == nullptr) { return; }
+
+    std::vector<Expression*> arguments;
+    auto head = flatten(application, arguments);
+
+    Signature signature;
+    auto variable = dynamic_cast<Variable*>(head);
+    if (
+      variable != nullptr
+      && bound_variables.count(variable->get_literal()) == 0
+    ) {
+      if (auto known = signature_of(variable->get_literal())) {
+        signature = *known;
+      }
+    }
+    else if (dynamic_cast<Abstraction*>(head) != nullptr) {
+      signature = abstraction_signature(head, bound_variables);
+    }
+
+    if (!signature.empty() && arguments.size() >= signature.size()) {
+      for (size_t i = 0; i < signature.size(); i++) {
+        if (
+          !signature[i].is_strict
+          || !signature[i].is_shared
+          || !is_markable(arguments[i])
+        ) {
+          continue;
+        }
+        arguments[i]->set_computational_priority(ComputationalPriority::HeadEager);
+        report += (report.empty() ? "{" : " {") + arguments[i]->to_string() + "}";
+      }
+    }
+
+    mark(head, bound_variables, report);
+    for (auto argument: arguments) {
+      mark(argument, bound_variables, report);
+    }
+  }
+
+}
@@ -0,0 +1,508 @@
+// differential testing of the reducer: random well-scoped queries are
+// reduced by the plain `lambda` and by every variant, i.e. the same binary
+// with other switches such as `--engine net`. normal forms must be alpha
+// equivalent, and steps, time and memory are compared with the plain run.
+//
+//   fuzz [--lambda PATH] [--lib DIR] [--seed N] [--count N] [--size N]
+//        [--depth N] [--definitions N] [--timeout SECONDS]
+//        [--threshold PERCENT] [--variant "SWITCHES"]...
+//
+// with `--definitions N`, every query comes with N definitions of its own,
+// `# local0 := ...` and so on, which it and the later ones refer to, so that
+// the passes over the definitions of the input file are exercised too.
+// the plain run is given `--timeout` seconds, variants twice as long. terms
+// whose plain run does not finish are skipped. exits with 1 when a variant
+// gave another normal form, failed or timed out, regressions are only logged
+
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <sstream>
+#include <fstream>
+#include <stdexcept>
+#include <iostream>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace lambda::fuzz {
+
+  struct Options {
+    std::string lambda_path = "build/lambda";
+    std::string lib_path = "lib";
+    unsigned long long seed = 0;
+    unsigned count = 100;
+    // nodes of a query, roughly
+    unsigned size = 12;
+    unsigned depth = 6;
+    // definitions of the input file generated along with each query
+    unsigned definition_count = 0;
+    unsigned timeout_seconds = 2;
+    // a variant regresses when it takes this many percent more
+    unsigned threshold = 50;
+    std::vector<std::string> variants;
+  };
+
+  // combinators of lib/ that terminate on any argument they are given, and
+  // numerals, which stand for Church numerals
+  static const char* COMBINATORS[] = {
+    "T", "F", "&", "|", "!",
+    "++n", "--n", "+n", "-n", "*n", "0n?", "<=n",
+    "[]", "[", "]",
+    "0", "1", "2", "3"
+  };
+
+  static const char* IMPORTS[] = {
+    "logic.lambda", "nature.lambda", "pair.lambda", "control.lambda"
+  };
+
+  // random queries over bound variables, combinators, abstractions and
+  // applications, with `{}` and `$` on some of the arguments
+  class TermGenerator {
+  public:
+    TermGenerator(unsigned long long seed): random(seed) {}
+
+    auto generate(unsigned size, unsigned depth) -> std::string {
+      std::vector<std::string> scope;
+      return term(size, depth, scope);
+    }
+
+    // `# literal := \v0.\v1. M`, closed over its parameters. the generated
+    // terms refer to it from now on, until `clear_symbols()`
+    auto define(
+      const std::string& literal,
+      unsigned size,
+      unsigned depth
+    ) -> std::string {
+      std::vector<std::string> scope = { "v0", "v1" };
+      auto body = term(size, depth, scope);
+      symbols.push_back(literal);
+      return "# " + literal + " := \\v0.\\v1. " + body;
+    }
+
+    void clear_symbols() {
+      symbols.clear();
+    }
+
+  private:
+    std::mt19937_64 random;
+    // defined by `define`, taken as combinators
+    std::vector<std::string> symbols;
+
+    auto chance(unsigned percent) -> bool {
+      return random() % 100 < percent;
+    }
+
+    auto atom(std::vector<std::string>& scope) -> std::string {
+      if (!scope.empty() && chance(60)) {
+        return scope[random() % scope.size()];
+      }
+      if (!symbols.empty() && chance(30)) {
+        return symbols[random() % symbols.size()];
+      }
+      return COMBINATORS[random() % (sizeof(COMBINATORS) / sizeof(*COMBINATORS))];
+    }
+
+    auto term(
+      unsigned size,
+      unsigned depth,
+      std::vector<std::string>& scope
+    ) -> std::string {
+      if (size <= 1 || depth == 0) { return atom(scope); }
+
+      if (chance(35)) {
+        // fresh names, so that shadowing is only introduced by reduction
+        auto binder = "v" + std::to_string(scope.size());
+        scope.push_back(binder);
+        auto body = term(size - 1, depth - 1, scope);
+        scope.pop_back();
+        return "\\" + binder + ". " + body;
+      }
+
+      auto first_size = 1 + random() % (size - 1);
+      auto first = term(first_size, depth - 1, scope);
+      auto second = term(size - first_size, depth - 1, scope);
+
+      if (first[0] == '\\') { first = "(" + first + ")"; }
+      if (chance(15)) {
+        second = "{" + second + "}";
+      }
+      else if (chance(15)) {
+        second = "$(" + second + ")";
+      }
+      else if (second.find(' ') != std::string::npos) {
+        second = "(" + second + ")";
+      }
+      return first + " " + second;
+    }
+  };
+
+  // what a run of `lambda` printed about the query
+  struct Run {
+    bool is_finished = false;
+    // the last line printed when there is no result, e.g. an error
+    std::string error;
+    std::string result;
+    unsigned long long step = 0;
+    unsigned long long msec = 0;
+    // peak resident memory, in kilobytes
+    long maxrss = 0;
+  };
+
+  static auto field(const std::string& output, const std::string& name) -> std::string {
+    auto position = output.find("\n" + name);
+    if (position == std::string::npos) { return ""; }
+    position = output.find_first_not_of(' ', position + name.length() + 1);
+    return output.substr(position, output.find('\n', position) - position);
+  }
+
+  static auto run(
+    const Options& options,
+    const std::string& query_path,
+    const std::string& switches,
+    unsigned timeout_seconds
+  ) -> Run {
+    auto output_path = query_path + ".out";
+    auto command = "exec " + options.lambda_path + " " + query_path + " " + switches;
+
+    auto pid = fork();
+    if (pid < 0) { throw std::runtime_error("cannot fork"); }
+    if (pid == 0) {
+      auto fd = open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      dup2(fd, STDOUT_FILENO);
+      dup2(fd, STDERR_FILENO);
+      close(fd);
+      execl("/bin/sh", "sh", "-c", command.c_str(), (char*)nullptr);
+      _exit(127);
+    }
+
+    Run run;
+    int status;
+    struct rusage usage;
+    auto deadline = time(nullptr) + timeout_seconds;
+    for (;;) {
+      auto waited = wait4(pid, &status, WNOHANG, &usage);
+      if (waited == pid) { break; }
+      if (time(nullptr) >= deadline) {
+        kill(pid, SIGKILL);
+        wait4(pid, &status, 0, &usage);
+        return run;
+      }
+      usleep(2000);
+    }
+    run.is_finished = true;
+    run.maxrss = usage.ru_maxrss;
+
+    std::ifstream file(output_path);
+    std::stringstream stream;
+    stream << file.rdbuf();
+    auto output = "\n" + stream.str();
+
+    run.result = field(output, "result:");
+    if (run.result.empty()) {
+      // the query is printed first, the error last
+      auto end = output.find_last_not_of('\n');
+      auto begin = output.rfind('\n', end);
+      run.error = end == std::string::npos || end == 0
+        ? "no output"
+        : output.substr(begin + 1, end - begin);
+      return run;
+    }
+    run.step = std::stoull("0" + field(output, "step taken:"));
+    run.msec = std::stoull("0" + field(output, "time cost:"));
+    return run;
+  }
+
+  // a term as printed by `to_string`, with bound variables replaced by de
+  // Bruijn indices, so that alpha equivalent terms read the same
+  class Canonicalizer {
+  public:
+    Canonicalizer(const std::string& text): text(text), position(0) {}
+
+    auto canonicalize() -> std::string {
+      auto result = term();
+      skip_spaces();
+      if (position != text.length()) { throw std::runtime_error("unreadable"); }
+      return result;
+    }
+
+  private:
+    const std::string& text;
+    size_t position;
+    std::vector<std::string> binders;
+
+    void skip_spaces() {
+      while (position < text.length() && text[position] == ' ') { position++; }
+    }
+
+    auto identifier() -> std::string {
+      auto begin = position;
+      while (
+        position < text.length()
+        && !strchr(" \\@#.:(){}$", text[position])
+      ) {
+        position++;
+      }
+      if (position == begin) { throw std::runtime_error("unreadable"); }
+      return text.substr(begin, position - begin);
+    }
+
+    auto term() -> std::string {
+      skip_spaces();
+      if (position < text.length() && text[position] == '\\') {
+        position++;
+        binders.push_back(identifier());
+        if (position >= text.length() || text[position] != '.') {
+          throw std::runtime_error("unreadable");
+        }
+        position++;
+        auto body = term();
+        binders.pop_back();
+        return "\\." + body;
+      }
+
+      auto result = atom();
+      for (;;) {
+        skip_spaces();
+        if (position >= text.length() || text[position] == ')') { break; }
+        result = "(" + result + " " + atom() + ")";
+      }
+      return result;
+    }
+
+    auto atom() -> std::string {
+      skip_spaces();
+      if (position < text.length() && text[position] == '(') {
+        position++;
+        auto result = term();
+        skip_spaces();
+        if (position >= text.length() || text[position] != ')') {
+          throw std::runtime_error("unreadable");
+        }
+        position++;
+        return result;
+      }
+      if (position < text.length() && text[position] == '\\') { return term(); }
+
+      auto literal = identifier();
+      for (auto i = binders.size(); i > 0; i--) {
+        if (binders[i - 1] == literal) {
+          return "#" + std::to_string(binders.size() - i);
+        }
+      }
+      return literal;
+    }
+  };
+
+  static auto canonical(const std::string& term) -> std::string {
+    try {
+      return Canonicalizer(term).canonicalize();
+    }
+    catch (std::runtime_error&) {
+      return term;
+    }
+  }
+
+  static bool regresses(double value, double baseline, unsigned threshold) {
+    return value > baseline * (1 + threshold / 100.0);
+  }
+
+  static auto percent(double value, double baseline) -> std::string {
+    return "+" + std::to_string((long)((value / baseline - 1) * 100)) + "%";
+  }
+
+  // counts per variant
+  struct Tally {
+    unsigned mismatches = 0;
+    unsigned failures = 0;
+    unsigned timeouts = 0;
+    unsigned regressions = 0;
+  };
+
+  // the directory of `path` as seen from `from`, both absolute
+  static auto relative_path(const std::string& from, const std::string& path) -> std::string {
+    auto result = std::string("");
+    for (auto ch: from) {
+      if (ch == '/') { result += "../"; }
+    }
+    return result + path.substr(1) + "/";
+  }
+
+  static auto absolute_path(const std::string& path) -> std::string {
+    char buffer[PATH_MAX];
+    if (realpath(path.c_str(), buffer) == nullptr) {
+      throw std::runtime_error("cannot find " + path);
+    }
+    return buffer;
+  }
+
+  static void handle_args(int argc, char** argv, Options& options) {
+    auto value = [&](int& i) -> std::string {
+      if (++i >= argc) {
+        throw std::runtime_error(std::string("argument missing for ") + argv[i - 1]);
+      }
+      return argv[i];
+    };
+
+    options.seed = std::random_device()();
+    for (int i = 1; i < argc; i++) {
+      if (!strcmp(argv[i], "--lambda")) { options.lambda_path = value(i); }
+      else if (!strcmp(argv[i], "--lib")) { options.lib_path = value(i); }
+      else if (!strcmp(argv[i], "--seed")) { options.seed = std::stoull(value(i)); }
+      else if (!strcmp(argv[i], "--count")) { options.count = std::stoul(value(i)); }
+      else if (!strcmp(argv[i], "--size")) { options.size = std::stoul(value(i)); }
+      else if (!strcmp(argv[i], "--depth")) { options.depth = std::stoul(value(i)); }
+      else if (!strcmp(argv[i], "--definitions")) {
+        options.definition_count = std::stoul(value(i));
+      }
+      else if (!strcmp(argv[i], "--timeout")) {
+        options.timeout_seconds = std::stoul(value(i));
+      }
+      else if (!strcmp(argv[i], "--threshold")) {
+        options.threshold = std::stoul(value(i));
+      }
+      else if (!strcmp(argv[i], "--variant")) { options.variants.push_back(value(i)); }
+      else { throw std::runtime_error(std::string("unknown option ") + argv[i]); }
+    }
+
+    if (options.variants.empty()) {
+      options.variants = {
+        "--explicit-substitution", "--native", "--lazy-imports", "--engine net",
+        "--engine ski", "--optimize", "--strictness", "--prenormalize 1000",
+        "--detect-divergence"
+      };
+    }
+  }
+
+  static auto fuzz(Options& options) -> int {
+    options.lambda_path = absolute_path(options.lambda_path);
+    auto lib_path = absolute_path(options.lib_path);
+
+    char directory_template[] = "/tmp/lambda-fuzz-XXXXXX";
+    auto directory = std::string(mkdtemp(directory_template));
+    auto query_path = directory + "/query.lambda";
+    auto imports = std::string("");
+    for (auto file: IMPORTS) {
+      imports += "import \"" + relative_path(directory, lib_path) + file + "\"\n";
+    }
+
+    std::cout << "seed " << options.seed << std::endl;
+    TermGenerator generator(options.seed);
+    std::map<std::string, Tally> tallies;
+    unsigned skipped = 0;
+    bool has_failed = false;
+
+    for (unsigned index = 0; index < options.count; index++) {
+      auto definitions = std::string("");
+      for (unsigned i = 0; i < options.definition_count; i++) {
+        definitions += generator.define(
+          "local" + std::to_string(i), options.size, options.depth
+        ) + "\n";
+      }
+      auto query = generator.generate(options.size, options.depth);
+      generator.clear_symbols();
+      std::ofstream(query_path) << imports << definitions << "@ " << query << "\n";
+
+      auto baseline = run(options, query_path, "", options.timeout_seconds);
+      if (!baseline.is_finished || !baseline.error.empty()) {
+        skipped++;
+        continue;
+      }
+      auto expected = canonical(baseline.result);
+
+      for (auto& variant: options.variants) {
+        auto& tally = tallies[variant];
+        auto other = run(options, query_path, variant, 2 * options.timeout_seconds);
+
+        auto report = [&](const std::string& what) {
+          std::cout << "#" << index << " [" << variant << "] " << what << "\n";
+          std::istringstream lines(definitions);
+          for (std::string line; std::getline(lines, line);) {
+            std::cout << "  " << line << "\n";
+          }
+          std::cout << "  @ " << query << std::endl;
+        };
+
+        if (!other.is_finished) {
+          tally.timeouts++;
+          has_failed = true;
+          report("timeout, plain run took " + std::to_string(baseline.msec) + "ms");
+        }
+        else if (!other.error.empty()) {
+          tally.failures++;
+          has_failed = true;
+          report("failed: " + other.error);
+        }
+        else if (canonical(other.result) != expected) {
+          tally.mismatches++;
+          has_failed = true;
+          report(
+            "normal form differs\n  expected " + baseline.result
+              + "\n  got      " + other.result
+          );
+        }
+        else {
+          std::string regressions;
+          if (regresses(other.step, baseline.step, options.threshold)) {
+            regressions += " steps " + std::to_string(baseline.step) + " -> "
+              + std::to_string(other.step) + " " + percent(other.step, baseline.step);
+          }
+          // shorter times are noise
+          if (
+            other.msec >= 10
+            && regresses(other.msec, baseline.msec + 1, options.threshold)
+          ) {
+            regressions += " time " + std::to_string(baseline.msec) + "ms -> "
+              + std::to_string(other.msec) + "ms "
+              + percent(other.msec, baseline.msec + 1);
+          }
+          if (regresses(other.maxrss, baseline.maxrss, options.threshold)) {
+            regressions += " memory " + std::to_string(baseline.maxrss) + "KB -> "
+              + std::to_string(other.maxrss) + "KB "
+              + percent(other.maxrss, baseline.maxrss);
+          }
+          if (!regressions.empty()) {
+            tally.regressions++;
+            report("regression:" + regressions);
+          }
+        }
+      }
+    }
+
+    remove((query_path + ".out").c_str());
+    remove(query_path.c_str());
+    rmdir(directory.c_str());
+
+    std::cout << "\n" << options.count << " queries, " << skipped
+      << " skipped as the plain run failed or did not finish\n";
+    for (auto& variant: options.variants) {
+      auto& tally = tallies[variant];
+      std::cout << "[" << variant << "] "
+        << tally.mismatches << " mismatches, "
+        << tally.failures << " failures, "
+        << tally.timeouts << " timeouts, "
+        << tally.regressions << " regressions\n";
+    }
+    return has_failed ? 1 : 0;
+  }
+
+}
+
+int main(int argc, char** argv) {
+  try {
+    lambda::fuzz::Options options;
+    lambda::fuzz::handle_args(argc, argv, options);
+    return lambda::fuzz::fuzz(options);
+  }
+  catch (std::runtime_error& error) {
+    std::cout << error.what() << std::endl;
+    return 2;
+  }
+}